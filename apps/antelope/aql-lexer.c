@@ -100,6 +100,7 @@ static const struct keyword keywords[] = {
   {"DOMAIN", DOMAIN},
   {"STRING", STRING},
   {"INLINE", INLINE},
+  {"BPTREE", BPTREE},
 
   {"PROJECT", PROJECT},
   {"MAXHEAP", MAXHEAP},
@@ -111,7 +112,7 @@ static const struct keyword keywords[] = {
 };
 
 /* Provides a pointer to the first keyword of a specific length. */
-static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 44, 47, 48};
+static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 45, 48, 49};
 
 static char separators[] = "#.;,() \t\n";
 
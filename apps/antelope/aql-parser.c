@@ -645,6 +645,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BPTREE:
+    type = INDEX_BPTREE;
+    break;
   default:
     return NONE;
   };
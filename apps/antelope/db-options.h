@@ -152,6 +152,19 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* The size of the buffer that sequential scans read rows into. Each
+   buffer refill costs one read from the file system, so a size near
+   the page size of the file system gives the fewest reads. The buffer
+   must hold at least one row of the largest possible size, which is
+   DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE bytes. */
+#ifndef DB_SCAN_BUFFER_SIZE
+#define DB_SCAN_BUFFER_SIZE		128
+#endif /* DB_SCAN_BUFFER_SIZE */
+
+#if DB_SCAN_BUFFER_SIZE < DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE
+#error "DB_SCAN_BUFFER_SIZE must hold at least one row of the largest size"
+#endif
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
@@ -188,13 +201,38 @@
 
 /* The maximum number of hash table indexes. */
 #ifndef DB_MEMHASH_INDEX_LIMIT
-#define DB_MEMHASH_INDEX_LIMIT  	1
+#define DB_MEMHASH_INDEX_LIMIT  	2
 #endif /* DB_MEMHASH_INDEX_LIMIT */
 
-/* The default hash table index size. */
-#ifndef DB_MEMHASH_TABLE_SIZE
-#define DB_MEMHASH_TABLE_SIZE		61
-#endif /* DB_MEMHASH_TABLE_SIZE */
+/* The maximum number of keys stored in all hash table indexes. The
+   indexes keep their keys in RAM, so this is a hard cap: an index
+   that cannot store a key gives up, and queries on it fall back to
+   scanning the relation. */
+#ifndef DB_MEMHASH_ENTRY_LIMIT
+#define DB_MEMHASH_ENTRY_LIMIT		128
+#endif /* DB_MEMHASH_ENTRY_LIMIT */
+
+/* The average number of keys per bucket above which a hash table
+   index adds a bucket. */
+#ifndef DB_MEMHASH_LOAD_FACTOR
+#define DB_MEMHASH_LOAD_FACTOR		2
+#endif /* DB_MEMHASH_LOAD_FACTOR */
+
+/* The number of buckets that a hash table index allocates at a time.
+   This value must be a power of two. */
+#ifndef DB_MEMHASH_SEGMENT_SIZE
+#define DB_MEMHASH_SEGMENT_SIZE		16
+#endif /* DB_MEMHASH_SEGMENT_SIZE */
+
+/* The maximum number of bucket segments in all hash table indexes.
+   By default, there are enough segments to keep the load factor when
+   all keys are stored, plus the initial segment of each index. */
+#ifndef DB_MEMHASH_SEGMENT_LIMIT
+#define DB_MEMHASH_SEGMENT_LIMIT					\
+  ((DB_MEMHASH_ENTRY_LIMIT / DB_MEMHASH_LOAD_FACTOR +			\
+    DB_MEMHASH_SEGMENT_SIZE - 1) / DB_MEMHASH_SEGMENT_SIZE +		\
+   DB_MEMHASH_INDEX_LIMIT)
+#endif /* DB_MEMHASH_SEGMENT_LIMIT */
 
 /* The maximum number of Maxheap indexes. */
 #ifndef DB_HEAP_INDEX_LIMIT
@@ -206,6 +244,49 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BPTREE_INDEX_LIMIT
+#define DB_BPTREE_INDEX_LIMIT		1
+#endif /* DB_BPTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree node in storage. Changing it makes existing
+   B+-tree index files unreadable. */
+#ifndef DB_BPTREE_NODE_SIZE
+#define DB_BPTREE_NODE_SIZE		128
+#endif /* DB_BPTREE_NODE_SIZE */
+
+/* The maximum number of nodes cached by all B+-tree indexes. */
+#ifndef DB_BPTREE_CACHE_LIMIT
+#define DB_BPTREE_CACHE_LIMIT		2
+#endif /* DB_BPTREE_CACHE_LIMIT */
+
+/* The number of keys sorted in RAM at a time when a B+-tree is built
+   for a relation that already has tuples. */
+#ifndef DB_BPTREE_BULK_PAIRS
+#define DB_BPTREE_BULK_PAIRS		16
+#endif /* DB_BPTREE_BULK_PAIRS */
+
+/*----------------------------------------------------------------------------*/
+
+/* Join options. */
+
+/* The number of tuples of the smaller relation that a hash join keeps
+   in RAM at a time. */
+#ifndef DB_JOIN_HASH_SIZE
+#define DB_JOIN_HASH_SIZE		32
+#endif /* DB_JOIN_HASH_SIZE */
+
+/* The number of buckets in the hash table of a hash join. */
+#ifndef DB_JOIN_HASH_BUCKETS
+#define DB_JOIN_HASH_BUCKETS		16
+#endif /* DB_JOIN_HASH_BUCKETS */
+
+/* The maximum number of files that a hash join partitions each relation
+   into when the smaller relation does not fit in RAM. */
+#ifndef DB_JOIN_PARTITIONS
+#define DB_JOIN_PARTITIONS		4
+#endif /* DB_JOIN_PARTITIONS */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -222,6 +303,17 @@
 #define LVM_MAX_VARIABLE_ID		AQL_ATTRIBUTE_LIMIT - 1
 #endif /* LVM_MAX_VARIABLE_ID */
 
+/* The maximum size of a predicate compiled to stack code. Predicates
+   that do not fit are interpreted from the LVM bytecode instead. */
+#ifndef LVM_PROGRAM_SIZE
+#define LVM_PROGRAM_SIZE		DB_VM_BYTECODE_SIZE
+#endif /* LVM_PROGRAM_SIZE */
+
+/* The maximum evaluation stack depth of a compiled predicate. */
+#ifndef LVM_STACK_SIZE
+#define LVM_STACK_SIZE			8
+#endif /* LVM_STACK_SIZE */
+
 /* Specify whether floats should be used or not inside the LVM. */
 #ifndef LVM_USE_FLOATS
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
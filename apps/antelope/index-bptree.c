@@ -0,0 +1,964 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index stored in a single file.
+ *
+ *     The tree consists of fixed-size nodes, which are addressed by
+ *     their position in the index file. Node 0 holds the header of
+ *     the tree. The leaves store sorted (key, tuple ID) pairs and are
+ *     linked from left to right, so a range search descends to the
+ *     first key in the range and then follows the leaf links until
+ *     the range ends. Keys that occur several times are kept next to
+ *     each other in the leaves.
+ *
+ *     An index created for a relation that already has tuples is
+ *     built bottom-up: the keys are sorted in runs that fit in RAM,
+ *     the runs are merged in temporary files, and the leaves and the
+ *     inner levels are then written in a single sequential pass.
+ *
+ *     Deletions remove pairs from the leaves without rebalancing the
+ *     tree. Space taken by deleted pairs is reused by later
+ *     insertions of nearby keys.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+typedef int32_t bptree_key_t;
+typedef uint16_t bptree_node_id_t;
+
+#define NODE_ID_LIMIT	65535U
+
+/* The number of (key, value) pairs that fit in a node, after a
+   4-byte node header. Each pair takes 8 bytes. */
+#define ORDER	((DB_BPTREE_NODE_SIZE - 4) / 8)
+
+#if ORDER < 3
+#error "DB_BPTREE_NODE_SIZE is too small."
+#endif
+
+#if ORDER > 255
+#error "DB_BPTREE_NODE_SIZE is too large."
+#endif
+
+/* A tree of this height holds far more pairs than a relation. */
+#define MAX_HEIGHT	8
+
+/*
+ * In a leaf, the link is the ID of the next leaf, or 0 in the last
+ * leaf, and the values are tuple IDs. In an inner node, the link is
+ * the child that holds the keys smaller than keys[0], and values[i]
+ * is the child that holds the keys from keys[i] up to keys[i + 1].
+ */
+struct bptree_node {
+  uint8_t leaf;
+  uint8_t count;
+  bptree_node_id_t link;
+  bptree_key_t keys[ORDER];
+  uint32_t values[ORDER];
+};
+
+struct bptree_header {
+  bptree_node_id_t root;
+  bptree_node_id_t nodes;
+  uint8_t height;
+};
+
+struct bptree {
+  db_storage_id_t fd;
+  struct bptree_header header;
+};
+
+struct node_cache {
+  struct bptree *tree;
+  bptree_node_id_t id;
+  uint16_t used;
+  struct bptree_node node;
+};
+
+struct pair {
+  bptree_key_t key;
+  uint32_t value;
+};
+
+/* The bulk builder merges this many sorted runs at once. */
+#define MERGE_WAYS	4
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_bptree = {
+  INDEX_BPTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES | INDEX_API_BULK_LOAD,
+  3,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+MEMB(trees, struct bptree, DB_BPTREE_INDEX_LIMIT);
+
+/* Keep a cache of nodes read from storage. */
+static struct node_cache node_cache[DB_BPTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+
+/* Pairs that are sorted in RAM during a bulk build. */
+static struct pair bulk_pairs[DB_BPTREE_BULK_PAIRS];
+
+/* The nodes being modified by an insertion or a bulk build. */
+static struct bptree_node node;
+static struct bptree_node sibling;
+
+static struct node_cache *
+cache_lookup(struct bptree *tree, bptree_node_id_t id)
+{
+  int i;
+  struct node_cache *victim;
+
+  victim = &node_cache[0];
+  for(i = 0; i < DB_BPTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].id == id) {
+      node_cache[i].used = ++cache_clock;
+      return &node_cache[i];
+    }
+    if(node_cache[i].tree == NULL) {
+      victim = &node_cache[i];
+    } else if(victim->tree != NULL &&
+              (uint16_t)(cache_clock - node_cache[i].used) >
+              (uint16_t)(cache_clock - victim->used)) {
+      victim = &node_cache[i];
+    }
+  }
+
+  /* Return the least recently used entry without a tree, so that
+     the caller fills it. */
+  victim->tree = NULL;
+  victim->used = ++cache_clock;
+  return victim;
+}
+
+static void
+cache_invalidate(struct bptree *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BPTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static int
+node_read(struct bptree *tree, bptree_node_id_t id, struct bptree_node *dest)
+{
+  struct node_cache *entry;
+
+  entry = cache_lookup(tree, id);
+  if(entry->tree == NULL) {
+    if(DB_ERROR(storage_read(tree->fd, &entry->node,
+                             (unsigned long)id * DB_BPTREE_NODE_SIZE,
+                             sizeof(entry->node)))) {
+      PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)id);
+      return 0;
+    }
+    entry->tree = tree;
+    entry->id = id;
+  }
+
+  memcpy(dest, &entry->node, sizeof(*dest));
+  return 1;
+}
+
+static int
+node_write(struct bptree *tree, bptree_node_id_t id, struct bptree_node *src)
+{
+  struct node_cache *entry;
+
+  entry = cache_lookup(tree, id);
+  entry->tree = NULL;
+
+  if(DB_ERROR(storage_write(tree->fd, src,
+                            (unsigned long)id * DB_BPTREE_NODE_SIZE,
+                            sizeof(*src)))) {
+    PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)id);
+    return 0;
+  }
+
+  memcpy(&entry->node, src, sizeof(entry->node));
+  entry->tree = tree;
+  entry->id = id;
+  return 1;
+}
+
+static int
+header_write(struct bptree *tree)
+{
+  return !DB_ERROR(storage_write(tree->fd, &tree->header, 0,
+                                 sizeof(tree->header)));
+}
+
+static bptree_node_id_t
+node_alloc(struct bptree *tree)
+{
+  if(tree->header.nodes == NODE_ID_LIMIT) {
+    PRINTF("DB: No more B+-tree nodes available\n");
+    return 0;
+  }
+  return tree->header.nodes++;
+}
+
+/* Count the keys that are smaller than the key, or that are not
+   larger than it if upper is set. */
+static int
+node_search(struct bptree_node *n, bptree_key_t key, int upper)
+{
+  int low;
+  int high;
+  int mid;
+
+  low = 0;
+  high = n->count;
+  while(low < high) {
+    mid = (low + high) / 2;
+    if(n->keys[mid] < key || (upper && n->keys[mid] == key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static bptree_node_id_t
+node_child(struct bptree_node *n, int i)
+{
+  return i == 0 ? n->link : (bptree_node_id_t)n->values[i - 1];
+}
+
+/* Find the leftmost leaf that may hold the key. */
+static bptree_node_id_t
+find_leaf(struct bptree *tree, bptree_key_t key, struct bptree_node *n)
+{
+  bptree_node_id_t id;
+  int level;
+
+  id = tree->header.root;
+  for(level = 1; id != 0 && level < tree->header.height; level++) {
+    if(!node_read(tree, id, n)) {
+      return 0;
+    }
+    id = node_child(n, node_search(n, key, 0));
+  }
+  return id;
+}
+
+static void
+node_insert_pair(struct bptree_node *n, int pos,
+                 bptree_key_t key, uint32_t value)
+{
+  memmove(&n->keys[pos + 1], &n->keys[pos],
+          (n->count - pos) * sizeof(n->keys[0]));
+  memmove(&n->values[pos + 1], &n->values[pos],
+          (n->count - pos) * sizeof(n->values[0]));
+  n->keys[pos] = key;
+  n->values[pos] = value;
+  n->count++;
+}
+
+static db_result_t
+tree_insert(struct bptree *tree, bptree_key_t key, uint32_t value)
+{
+  static bptree_key_t keys[ORDER + 1];
+  static uint32_t values[ORDER + 1];
+  bptree_node_id_t path[MAX_HEIGHT];
+  uint8_t slots[MAX_HEIGHT];
+  bptree_node_id_t id;
+  bptree_node_id_t sibling_id;
+  int level;
+  int pos;
+  int left;
+  int append;
+
+  if(tree->header.root == 0) {
+    id = node_alloc(tree);
+    if(id == 0) {
+      return DB_INDEX_ERROR;
+    }
+    memset(&node, 0, sizeof(node));
+    node.leaf = 1;
+    node_insert_pair(&node, 0, key, value);
+    tree->header.root = id;
+    tree->header.height = 1;
+    if(!node_write(tree, id, &node) || !header_write(tree)) {
+      return DB_STORAGE_ERROR;
+    }
+    return DB_OK;
+  }
+
+  /* Descend to the rightmost position for the key, remembering the
+     path for splitting the nodes on the way back up. */
+  append = 1;
+  id = tree->header.root;
+  for(level = 0; level < tree->header.height - 1; level++) {
+    if(!node_read(tree, id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+    pos = node_search(&node, key, 1);
+    append &= pos == node.count;
+    path[level] = id;
+    slots[level] = pos;
+    id = node_child(&node, pos);
+  }
+
+  if(!node_read(tree, id, &node)) {
+    return DB_STORAGE_ERROR;
+  }
+  pos = node_search(&node, key, 1);
+  append &= pos == node.count;
+
+  for(;;) {
+    if(node.count < ORDER) {
+      node_insert_pair(&node, pos, key, value);
+      return node_write(tree, id, &node) ? DB_OK : DB_STORAGE_ERROR;
+    }
+
+    sibling_id = node_alloc(tree);
+    if(sibling_id == 0) {
+      return DB_INDEX_ERROR;
+    }
+
+    memcpy(keys, node.keys, pos * sizeof(keys[0]));
+    memcpy(values, node.values, pos * sizeof(values[0]));
+    keys[pos] = key;
+    values[pos] = value;
+    memcpy(&keys[pos + 1], &node.keys[pos], (ORDER - pos) * sizeof(keys[0]));
+    memcpy(&values[pos + 1], &node.values[pos],
+           (ORDER - pos) * sizeof(values[0]));
+
+    /* Keys that arrive in ascending order leave the old nodes full
+       instead of half full. */
+    memset(&sibling, 0, sizeof(sibling));
+    sibling.leaf = node.leaf;
+    if(node.leaf) {
+      left = append ? ORDER : (ORDER + 1) / 2;
+      sibling.count = ORDER + 1 - left;
+      memcpy(sibling.keys, &keys[left], sibling.count * sizeof(keys[0]));
+      memcpy(sibling.values, &values[left], sibling.count * sizeof(values[0]));
+      sibling.link = node.link;
+      node.link = sibling_id;
+      key = sibling.keys[0];
+    } else {
+      /* The middle key moves up to the parent. */
+      left = append ? ORDER : ORDER / 2;
+      sibling.count = ORDER - left;
+      sibling.link = values[left];
+      memcpy(sibling.keys, &keys[left + 1], sibling.count * sizeof(keys[0]));
+      memcpy(sibling.values, &values[left + 1],
+             sibling.count * sizeof(values[0]));
+      key = keys[left];
+    }
+    node.count = left;
+    memcpy(node.keys, keys, left * sizeof(keys[0]));
+    memcpy(node.values, values, left * sizeof(values[0]));
+    value = sibling_id;
+
+    if(!node_write(tree, id, &node) || !node_write(tree, sibling_id, &sibling)) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(level == 0) {
+      /* The root was split; grow the tree by one level. */
+      if(tree->header.height == MAX_HEIGHT) {
+        return DB_INDEX_ERROR;
+      }
+      sibling_id = node_alloc(tree);
+      if(sibling_id == 0) {
+        return DB_INDEX_ERROR;
+      }
+      memset(&node, 0, sizeof(node));
+      node.link = id;
+      node_insert_pair(&node, 0, key, value);
+      if(!node_write(tree, sibling_id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+      tree->header.root = sibling_id;
+      tree->header.height++;
+      break;
+    }
+
+    level--;
+    id = path[level];
+    pos = slots[level];
+    if(!node_read(tree, id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  return header_write(tree) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+/* Append a pair to the leaves of a tree under bulk construction.
+   The leaves get consecutive node IDs starting from 1. */
+static int
+bulk_add(struct bptree *tree, bptree_key_t key, uint32_t value)
+{
+  if(node.count == ORDER) {
+    node.link = tree->header.nodes;
+    if(!node_write(tree, tree->header.nodes - 1, &node)) {
+      return 0;
+    }
+    node.count = 0;
+  }
+
+  if(node.count == 0 && node_alloc(tree) == 0) {
+    return 0;
+  }
+
+  node.keys[node.count] = key;
+  node.values[node.count] = value;
+  node.count++;
+  return 1;
+}
+
+static int
+subtree_min(struct bptree *tree, bptree_node_id_t id, bptree_key_t *key)
+{
+  do {
+    if(!node_read(tree, id, &sibling)) {
+      return 0;
+    }
+    id = sibling.link;
+  } while(!sibling.leaf);
+
+  *key = sibling.keys[0];
+  return 1;
+}
+
+/* Write the last leaf and build the inner levels on top of the
+   leaves, one level at a time. */
+static int
+bulk_finish(struct bptree *tree)
+{
+  bptree_node_id_t first;
+  bptree_node_id_t last;
+  bptree_node_id_t child;
+  bptree_node_id_t id;
+
+  if(node.count == 0) {
+    return 1;
+  }
+
+  node.link = 0;
+  if(!node_write(tree, tree->header.nodes - 1, &node)) {
+    return 0;
+  }
+
+  first = 1;
+  last = tree->header.nodes - 1;
+  tree->header.height = 1;
+
+  while(first != last) {
+    if(tree->header.height == MAX_HEIGHT) {
+      return 0;
+    }
+    child = first;
+    first = tree->header.nodes;
+    while(child <= last) {
+      id = node_alloc(tree);
+      if(id == 0) {
+        return 0;
+      }
+      memset(&node, 0, sizeof(node));
+      node.link = child++;
+      while(node.count < ORDER && child <= last) {
+        if(!subtree_min(tree, child, &node.keys[node.count])) {
+          return 0;
+        }
+        node.values[node.count++] = child++;
+      }
+      if(!node_write(tree, id, &node)) {
+        return 0;
+      }
+    }
+    last = tree->header.nodes - 1;
+    tree->header.height++;
+  }
+
+  tree->header.root = first;
+  return 1;
+}
+
+static void
+sort_pairs(struct pair *pairs, unsigned count)
+{
+  unsigned i;
+  unsigned j;
+  struct pair tmp;
+
+  /* Sort by key, and by tuple ID for equal keys. The runs are
+     short, so a stable insertion sort is sufficient. */
+  for(i = 1; i < count; i++) {
+    tmp = pairs[i];
+    for(j = i; j > 0 && pairs[j - 1].key > tmp.key; j--) {
+      pairs[j] = pairs[j - 1];
+    }
+    pairs[j] = tmp;
+  }
+}
+
+/* Merge the runs of a file in groups of MERGE_WAYS runs, writing
+   the merged runs to another file. */
+static int
+merge_runs(db_storage_id_t src, db_storage_id_t dst,
+           tuple_id_t count, tuple_id_t run)
+{
+  struct pair heads[MERGE_WAYS];
+  tuple_id_t pos[MERGE_WAYS];
+  tuple_id_t end[MERGE_WAYS];
+  tuple_id_t group;
+  tuple_id_t out;
+  unsigned buffered;
+  int ways;
+  int i;
+  int min;
+
+  out = 0;
+  for(group = 0; group < count; group += run * MERGE_WAYS) {
+    for(ways = 0; ways < MERGE_WAYS; ways++) {
+      pos[ways] = group + ways * run;
+      if(pos[ways] >= count) {
+        break;
+      }
+      end[ways] = pos[ways] + run < count ? pos[ways] + run : count;
+      if(DB_ERROR(storage_read(src, &heads[ways],
+                               pos[ways] * sizeof(struct pair),
+                               sizeof(struct pair)))) {
+        return 0;
+      }
+    }
+
+    buffered = 0;
+    for(;;) {
+      min = -1;
+      for(i = 0; i < ways; i++) {
+        if(pos[i] < end[i] &&
+           (min < 0 || heads[i].key < heads[min].key)) {
+          min = i;
+        }
+      }
+
+      if(min < 0 || buffered == DB_BPTREE_BULK_PAIRS) {
+        if(DB_ERROR(storage_write(dst, bulk_pairs, out * sizeof(struct pair),
+                                  buffered * sizeof(struct pair)))) {
+          return 0;
+        }
+        out += buffered;
+        buffered = 0;
+        if(min < 0) {
+          break;
+        }
+      }
+
+      bulk_pairs[buffered++] = heads[min];
+      if(++pos[min] < end[min] &&
+         DB_ERROR(storage_read(src, &heads[min],
+                               pos[min] * sizeof(struct pair),
+                               sizeof(struct pair)))) {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+static int
+write_run(db_storage_id_t fd, tuple_id_t offset, unsigned count)
+{
+  sort_pairs(bulk_pairs, count);
+  return !DB_ERROR(storage_write(fd, bulk_pairs,
+                                 offset * sizeof(struct pair),
+                                 count * sizeof(struct pair)));
+}
+
+static int
+bulk_load(struct bptree *tree, relation_t *rel, attribute_t *attr)
+{
+  static storage_cursor_t cursor;
+  char filenames[2][DB_MAX_FILENAME_LENGTH];
+  db_storage_id_t fds[2];
+  unsigned char row[rel->row_length];
+  attribute_value_t value;
+  tuple_id_t tuple_id;
+  tuple_id_t count;
+  tuple_id_t run;
+  tuple_id_t i;
+  unsigned buffered;
+  char *filename;
+  int src;
+  int result;
+  int r;
+
+  if(DB_ERROR(storage_cursor_open(&cursor, rel))) {
+    return 0;
+  }
+
+  PRINTF("DB: Bulk loading %lu tuples into a B+-tree\n",
+         (unsigned long)cursor.nrows);
+
+  result = 0;
+  fds[0] = fds[1] = -1;
+  filenames[0][0] = filenames[1][0] = '\0';
+
+  if(cursor.nrows > DB_BPTREE_BULK_PAIRS) {
+    /* The pairs do not fit in RAM; sort them in runs on storage. */
+    for(i = 0; i < 2; i++) {
+      filename = storage_generate_file("bpsort",
+                                       cursor.nrows * sizeof(struct pair));
+      if(filename == NULL) {
+        goto end;
+      }
+      memcpy(filenames[i], filename, sizeof(filenames[i]));
+      fds[i] = storage_open(filenames[i]);
+      if(fds[i] < 0) {
+        goto end;
+      }
+    }
+  }
+
+  count = 0;
+  buffered = 0;
+  for(tuple_id = 0;; tuple_id++) {
+    r = storage_cursor_get_row(&cursor, &tuple_id, row);
+    if(r == DB_FINISHED) {
+      break;
+    } else if(r != DB_OK ||
+              DB_ERROR(relation_get_value(rel, attr, row, &value))) {
+      goto end;
+    }
+
+    if(buffered == DB_BPTREE_BULK_PAIRS) {
+      if(!write_run(fds[0], count, buffered)) {
+        goto end;
+      }
+      count += buffered;
+      buffered = 0;
+    }
+
+    bulk_pairs[buffered].key = (bptree_key_t)db_value_to_long(&value);
+    bulk_pairs[buffered].value = tuple_id;
+    buffered++;
+  }
+
+  if(fds[0] < 0) {
+    sort_pairs(bulk_pairs, buffered);
+  } else if(!write_run(fds[0], count, buffered)) {
+    goto end;
+  }
+  count += buffered;
+
+  memset(&node, 0, sizeof(node));
+  node.leaf = 1;
+
+  if(fds[0] < 0) {
+    for(i = 0; i < count; i++) {
+      if(!bulk_add(tree, bulk_pairs[i].key, bulk_pairs[i].value)) {
+        goto end;
+      }
+    }
+  } else {
+    src = 0;
+    for(run = DB_BPTREE_BULK_PAIRS; run < count; run *= MERGE_WAYS) {
+      if(!merge_runs(fds[src], fds[!src], count, run)) {
+        goto end;
+      }
+      src = !src;
+    }
+
+    for(i = 0; i < count; i++) {
+      if(i % DB_BPTREE_BULK_PAIRS == 0) {
+        buffered = count - i < DB_BPTREE_BULK_PAIRS ?
+                   count - i : DB_BPTREE_BULK_PAIRS;
+        if(DB_ERROR(storage_read(fds[src], bulk_pairs,
+                                 i * sizeof(struct pair),
+                                 buffered * sizeof(struct pair)))) {
+          goto end;
+        }
+      }
+      if(!bulk_add(tree, bulk_pairs[i % DB_BPTREE_BULK_PAIRS].key,
+                   bulk_pairs[i % DB_BPTREE_BULK_PAIRS].value)) {
+        goto end;
+      }
+    }
+  }
+
+  result = bulk_finish(tree);
+
+end:
+  for(i = 0; i < 2; i++) {
+    if(fds[i] >= 0) {
+      storage_close(fds[i]);
+    }
+    if(filenames[i][0] != '\0') {
+      cfs_remove(filenames[i]);
+    }
+  }
+  return result;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  struct bptree *tree;
+  char *filename;
+
+  filename = storage_generate_file("bptree", DB_COFFEE_RESERVE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    return DB_ALLOCATION_ERROR;
+  }
+
+  memset(&tree->header, 0, sizeof(tree->header));
+  tree->header.nodes = 1;
+
+  tree->fd = storage_open(index->descriptor_file);
+  if(tree->fd < 0) {
+    goto fail;
+  }
+
+  if(!bulk_load(tree, index->rel, index->attr) || !header_write(tree)) {
+    PRINTF("DB: Failed to build a B+-tree for %s.%s\n",
+           index->rel->name, index->attr->name);
+    cache_invalidate(tree);
+    storage_close(tree->fd);
+    goto fail;
+  }
+
+  PRINTF("DB: Created a B+-tree of height %u with %u nodes in file %s\n",
+         (unsigned)tree->header.height, (unsigned)tree->header.nodes,
+         index->descriptor_file);
+
+  return DB_OK;
+
+fail:
+  memb_free(&trees, tree);
+  cfs_remove(index->descriptor_file);
+  return DB_INDEX_ERROR;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  /* The index has already been released by index_destroy(). */
+  return cfs_remove(index->descriptor_file) < 0 ? DB_STORAGE_ERROR : DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  struct bptree *tree;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->fd = storage_open(index->descriptor_file);
+  if(tree->fd < 0) {
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  if(DB_ERROR(storage_read(tree->fd, &tree->header, 0,
+                           sizeof(tree->header)))) {
+    storage_close(tree->fd);
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Loaded a B+-tree of height %u from file %s\n",
+         (unsigned)tree->header.height, index->descriptor_file);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  struct bptree *tree;
+
+  tree = index->opaque_data;
+
+  cache_invalidate(tree);
+  storage_close(tree->fd);
+  memb_free(&trees, tree);
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  long long_key;
+
+  long_key = db_value_to_long(key);
+
+  if(DB_ERROR(tree_insert(index->opaque_data, (bptree_key_t)long_key,
+                          value))) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n", long_key);
+    return DB_INDEX_ERROR;
+  }
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  struct bptree *tree;
+  bptree_node_id_t id;
+  bptree_key_t key;
+  int last;
+  int i;
+  int j;
+
+  tree = index->opaque_data;
+  key = (bptree_key_t)db_value_to_long(value);
+
+  for(id = find_leaf(tree, key, &node); id != 0; id = node.link) {
+    if(!node_read(tree, id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+
+    last = node.count == 0 || node.keys[node.count - 1] > key;
+
+    for(i = j = 0; i < node.count; i++) {
+      if(node.keys[i] != key) {
+        node.keys[j] = node.keys[i];
+        node.values[j] = node.values[i];
+        j++;
+      }
+    }
+
+    if(j != node.count) {
+      node.count = j;
+      if(!node_write(tree, id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+    }
+
+    if(last) {
+      break;
+    }
+  }
+
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  struct bptree *tree;
+  bptree_node_id_t id;
+  long min;
+  long max;
+  int slot;
+
+  tree = iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  /* An open range may extend beyond the keys of the tree. */
+  if(min < INT32_MIN) {
+    min = INT32_MIN;
+  } else if(min > INT32_MAX) {
+    return INVALID_TUPLE;
+  }
+
+  if(iterator->next_item_no == 0) {
+    id = find_leaf(tree, (bptree_key_t)min, &node);
+    slot = 0;
+  } else {
+    /* Continue after the last pair returned. */
+    id = iterator->position >> 8;
+    slot = iterator->position & 0xff;
+  }
+
+  for(; id != 0; id = node.link, slot = 0) {
+    if(!node_read(tree, id, &node)) {
+      return INVALID_TUPLE;
+    }
+
+    for(; slot < node.count; slot++) {
+      if(node.keys[slot] < min) {
+        continue;
+      }
+      if(node.keys[slot] > max) {
+        return INVALID_TUPLE;
+      }
+      iterator->position = ((uint32_t)id << 8) | (slot + 1);
+      iterator->next_item_no++;
+      return node.values[slot];
+    }
+  }
+
+  return INVALID_TUPLE;
+}
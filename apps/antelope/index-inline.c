@@ -73,6 +73,7 @@ static tuple_id_t get_next(index_iterator_t *);
 index_api_t index_inline = {
   INDEX_INLINE,
   INDEX_API_EXTERNAL | INDEX_API_COMPLETE | INDEX_API_RANGE_QUERIES,
+  16,
   null_op,
   null_op,
   null_op,
@@ -145,6 +145,7 @@ static tuple_id_t get_next(index_iterator_t *);
 index_api_t index_maxheap = {
   INDEX_MAXHEAP,
   INDEX_API_EXTERNAL,
+  NODE_DEPTH + 1,
   create,
   destroy,
   load,
@@ -30,16 +30,31 @@
 /**
  * \file
  *	A memory-resident hash map used as a DB index.
+ *
+ *	Keys that hash to the same bucket are chained. The map grows by
+ *	linear hashing: when the average chain exceeds the load factor,
+ *	the next bucket in turn is split in two, so the cost of growing
+ *	is spread over the insertions. Buckets are allocated in segments,
+ *	and the segments and the chained entries are taken from pools
+ *	shared by all hash indexes.
+ *
+ *	The keys are kept in RAM, so an index can hold at most
+ *	DB_MEMHASH_ENTRY_LIMIT keys. If an insertion finds no free entry,
+ *	the index frees its keys and is marked as failed. Queries then
+ *	scan the relation instead, and later insertions into the
+ *	relation are not held up by the index.
  * \author
  * 	Nicolas Tsiftes <nvt@sics.se>
  */
 
+#include <limits.h>
 #include <string.h>
 
 #include "lib/memb.h"
 
 #include "db-options.h"
 #include "index.h"
+#include "result.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -55,6 +70,7 @@ static tuple_id_t get_next(index_iterator_t *);
 index_api_t index_memhash = {
   INDEX_MEMHASH,
   INDEX_API_INTERNAL,
+  0,
   create,
   destroy,
   load,
@@ -64,38 +80,152 @@ index_api_t index_memhash = {
   get_next
 };
 
-struct hash_item {
+struct hash_entry {
+  struct hash_entry *next;
+  long key;
   tuple_id_t tuple_id;
-  attribute_value_t value;
 };
-typedef struct hash_item hash_item_t;
 
-typedef hash_item_t hash_map_t[DB_MEMHASH_TABLE_SIZE];
+struct hash_segment {
+  struct hash_entry *buckets[DB_MEMHASH_SEGMENT_SIZE];
+};
+
+/*
+ * Buckets below the split position have been split in the current
+ * round, and are addressed with one more bit of the hash value than
+ * the others. The round ends when all of the first "size" buckets
+ * have been split, and the size doubles.
+ */
+struct hash_map {
+  struct hash_segment *segments[DB_MEMHASH_SEGMENT_LIMIT];
+  unsigned size;
+  unsigned split;
+  tuple_id_t count;
+};
+
+MEMB(hash_map_memb, struct hash_map, DB_MEMHASH_INDEX_LIMIT);
+MEMB(hash_segment_memb, struct hash_segment, DB_MEMHASH_SEGMENT_LIMIT);
+MEMB(hash_entry_memb, struct hash_entry, DB_MEMHASH_ENTRY_LIMIT);
+
+static uint32_t
+calculate_hash(long key)
+{
+  uint32_t hash_value;
+
+  hash_value = (uint32_t)key;
+#if ULONG_MAX > 0xffffffffUL
+  hash_value ^= (uint32_t)((unsigned long)key >> 32);
+#endif
+
+  /* Mix all bits of the key into the low bits, which select the
+     bucket. This is the finalizer of MurmurHash3. */
+  hash_value ^= hash_value >> 16;
+  hash_value *= 0x85ebca6bUL;
+  hash_value ^= hash_value >> 13;
+  hash_value *= 0xc2b2ae35UL;
+  hash_value ^= hash_value >> 16;
+
+  return hash_value;
+}
+
+static struct hash_entry **
+get_bucket(struct hash_map *hash_map, unsigned bucket)
+{
+  return &hash_map->segments[bucket / DB_MEMHASH_SEGMENT_SIZE]->
+    buckets[bucket % DB_MEMHASH_SEGMENT_SIZE];
+}
+
+static struct hash_entry **
+find_bucket(struct hash_map *hash_map, long key)
+{
+  uint32_t hash_value;
+  unsigned bucket;
 
-MEMB(hash_map_memb, hash_map_t, DB_MEMHASH_INDEX_LIMIT);
+  hash_value = calculate_hash(key);
+  bucket = hash_value & (hash_map->size - 1);
+  if(bucket < hash_map->split) {
+    bucket = hash_value & (2 * hash_map->size - 1);
+  }
 
-static unsigned
-calculate_hash(attribute_value_t *value)
+  return get_bucket(hash_map, bucket);
+}
+
+static void
+grow(struct hash_map *hash_map)
 {
-  unsigned char *cp, *end;
-  unsigned hash_value;
+  unsigned new_bucket;
+  struct hash_segment **segment;
+  struct hash_entry **old_head;
+  struct hash_entry **new_head;
+  struct hash_entry *entry;
+  struct hash_entry *next;
+
+  new_bucket = hash_map->size + hash_map->split;
+  if(new_bucket / DB_MEMHASH_SEGMENT_SIZE >= DB_MEMHASH_SEGMENT_LIMIT) {
+    return;
+  }
 
-  cp = (unsigned char *)value;
-  end = cp + sizeof(*value);
-  hash_value = 0;
+  segment = &hash_map->segments[new_bucket / DB_MEMHASH_SEGMENT_SIZE];
+  if(*segment == NULL) {
+    *segment = memb_alloc(&hash_segment_memb);
+    if(*segment == NULL) {
+      /* The chains get longer until another index frees a segment. */
+      PRINTF("DB: No bucket segment available for the hash map\n");
+      return;
+    }
+    memset(*segment, 0, sizeof(**segment));
+  }
+
+  /* Move the entries whose next hash bit is set to the new bucket. */
+  old_head = get_bucket(hash_map, hash_map->split);
+  new_head = get_bucket(hash_map, new_bucket);
+  entry = *old_head;
+  *old_head = NULL;
+
+  for(; entry != NULL; entry = next) {
+    next = entry->next;
+    if(calculate_hash(entry->key) & hash_map->size) {
+      entry->next = *new_head;
+      *new_head = entry;
+    } else {
+      entry->next = *old_head;
+      *old_head = entry;
+    }
+  }
 
-  while(cp < end) {
-    hash_value = hash_value * 33 + *cp++;
+  hash_map->split++;
+  if(hash_map->split == hash_map->size) {
+    hash_map->size *= 2;
+    hash_map->split = 0;
   }
 
-  return hash_value % DB_MEMHASH_TABLE_SIZE;
+  PRINTF("DB: The hash map has grown to %u buckets\n",
+         hash_map->size + hash_map->split);
+}
+
+static void
+free_entries(struct hash_map *hash_map)
+{
+  struct hash_entry **head;
+  struct hash_entry *entry;
+  struct hash_entry *next;
+  unsigned bucket;
+
+  for(bucket = 0; bucket < hash_map->size + hash_map->split; bucket++) {
+    head = get_bucket(hash_map, bucket);
+    for(entry = *head; entry != NULL; entry = next) {
+      next = entry->next;
+      memb_free(&hash_entry_memb, entry);
+    }
+    *head = NULL;
+  }
+  hash_map->count = 0;
 }
 
 static db_result_t
 create(index_t *index)
 {
-  int i;
-  hash_map_t *hash_map;
+  struct hash_map *hash_map;
 
   PRINTF("Creating a memory-resident hash map index\n");
 
@@ -104,9 +234,16 @@ create(index_t *index)
     return DB_ALLOCATION_ERROR;
   }
 
-  for(i = 0; i < DB_MEMHASH_TABLE_SIZE; i++) {
-    hash_map[i]->tuple_id = INVALID_TUPLE;
+  memset(hash_map, 0, sizeof(*hash_map));
+
+  hash_map->segments[0] = memb_alloc(&hash_segment_memb);
+  if(hash_map->segments[0] == NULL) {
+    memb_free(&hash_map_memb, hash_map);
+    return DB_ALLOCATION_ERROR;
   }
+  memset(hash_map->segments[0], 0, sizeof(*hash_map->segments[0]));
+
+  hash_map->size = DB_MEMHASH_SEGMENT_SIZE;
 
   index->opaque_data = hash_map;
 
@@ -116,7 +253,20 @@ create(index_t *index)
 static db_result_t
 destroy(index_t *index)
 {
-  memb_free(&hash_map_memb, index->opaque_data);
+  struct hash_map *hash_map;
+  int i;
+
+  hash_map = index->opaque_data;
+
+  free_entries(hash_map);
+
+  for(i = 0; i < DB_MEMHASH_SEGMENT_LIMIT; i++) {
+    if(hash_map->segments[i] != NULL) {
+      memb_free(&hash_segment_memb, hash_map->segments[i]);
+    }
+  }
+
+  memb_free(&hash_map_memb, hash_map);
 
   return DB_OK;
 }
@@ -136,16 +286,39 @@ release(index_t *index)
 static db_result_t
 insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
+  struct hash_map *hash_map;
+  struct hash_entry *entry;
+  struct hash_entry **head;
 
   hash_map = index->opaque_data;
 
-  hash_value = calculate_hash(value);
-  hash_map[hash_value]->tuple_id = tuple_id;
-  hash_map[hash_value]->value = *value;
+  if(index->flags & INDEX_LOAD_ERROR) {
+    /* The index has given up; see below. */
+    return DB_OK;
+  }
+
+  entry = memb_alloc(&hash_entry_memb);
+  if(entry == NULL) {
+    PRINTF("DB: The hash map entries are exhausted; disabling the index\n");
+    free_entries(hash_map);
+    index->flags |= INDEX_LOAD_ERROR;
+    return DB_OK;
+  }
+
+  entry->key = db_value_to_long(value);
+  entry->tuple_id = tuple_id;
 
-  PRINTF("DB: Inserted value %ld into the hash table\n", VALUE_LONG(value));
+  head = find_bucket(hash_map, entry->key);
+  entry->next = *head;
+  *head = entry;
+
+  hash_map->count++;
+  if(hash_map->count >
+     (tuple_id_t)(hash_map->size + hash_map->split) * DB_MEMHASH_LOAD_FACTOR) {
+    grow(hash_map);
+  }
+
+  PRINTF("DB: Inserted value %ld into the hash table\n", entry->key);
 
   return DB_OK;
 }
@@ -153,42 +326,78 @@ insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
 static db_result_t
 delete(index_t *index, attribute_value_t *value)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
+  struct hash_map *hash_map;
+  struct hash_entry **entry_ptr;
+  struct hash_entry *entry;
+  long key;
 
   hash_map = index->opaque_data;
+  if(index->flags & INDEX_LOAD_ERROR) {
+    return DB_OK;
+  }
 
-  hash_value = calculate_hash(value);
-  if(memcmp(&hash_map[hash_value]->value, value, sizeof(*value)) != 0) {
-    return DB_INDEX_ERROR;
+  key = db_value_to_long(value);
+
+  /* Remove all entries of the key. */
+  for(entry_ptr = find_bucket(hash_map, key); *entry_ptr != NULL;) {
+    entry = *entry_ptr;
+    if(entry->key == key) {
+      *entry_ptr = entry->next;
+      memb_free(&hash_entry_memb, entry);
+      hash_map->count--;
+    } else {
+      entry_ptr = &entry->next;
+    }
   }
 
-  hash_map[hash_value]->tuple_id = INVALID_TUPLE;
   return DB_OK;
 }
 
 static tuple_id_t
 get_next(index_iterator_t *iterator)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
-
-  if(iterator->next_item_no == 1) {
-    /* The memhash supports only unique values at the moment. */
-    return INVALID_TUPLE;
-  }
+  struct hash_map *hash_map;
+  struct hash_entry *entry;
+  long key;
+  long max;
+  uint32_t skip;
 
   hash_map = iterator->index->opaque_data;
 
-  hash_value = calculate_hash(&iterator->min_value);
-  if(memcmp(&hash_map[hash_value]->value, &iterator->min_value, sizeof(iterator->min_value)) != 0) {
-    return INVALID_TUPLE;
+  /*
+   * A range is searched by looking up each key in it. The iterator
+   * keeps the key that it currently looks up in min_value, and the
+   * number of entries of that key already returned in position.
+   */
+  if(iterator->next_item_no == 0) {
+    iterator->position = 0;
   }
 
-  iterator->next_item_no++;
+  key = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  for(;;) {
+    skip = iterator->position;
+    for(entry = *find_bucket(hash_map, key);
+        entry != NULL;
+        entry = entry->next) {
+      if(entry->key == key && skip-- == 0) {
+        iterator->position++;
+        iterator->next_item_no++;
 
-  PRINTF("DB: Found value %ld in the hash table\n", 
-	VALUE_LONG(&iterator->min_value));
+        PRINTF("DB: Found value %ld in the hash table\n", key);
 
-  return hash_map[hash_value]->tuple_id;
+        return entry->tuple_id;
+      }
+    }
+
+    if(key >= max) {
+      return INVALID_TUPLE;
+    }
+
+    key++;
+    iterator->min_value.domain = DOMAIN_LONG;
+    VALUE_LONG(&iterator->min_value) = key;
+    iterator->position = 0;
+  }
 }
@@ -49,7 +49,7 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_memhash, &index_maxheap, &index_bptree};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -140,13 +140,15 @@ index_create(index_type_t index_type, relation_t *rel, attribute_t *attr)
     return DB_INDEX_ERROR;
   }
 
-  if(!(api->flags & INDEX_API_INLINE) && cardinality > 0) {
+  if(!(api->flags & (INDEX_API_INLINE | INDEX_API_BULK_LOAD)) &&
+     cardinality > 0) {
     PRINTF("DB: Created an index for an old relation; issuing a load request\n");
     index->flags = INDEX_LOAD_NEEDED;
     process_post(&db_indexer, load_request_event, NULL);
   } else {
     /* Inline indexes (i.e., those using the existing storage of the relation)
-       do not need to be reloaded after restarting the system. */
+       do not need to be reloaded after restarting the system. Indexes
+       that support bulk loading have already indexed the old tuples. */
     PRINTF("DB: Index created for attribute %s\n", attr->name);
     index->flags |= INDEX_READY;
   }
@@ -388,7 +390,7 @@ PROCESS_THREAD(db_indexer, ev, data)
       continue;
     }
 
-    for(;; row++) {
+    for(row = 0;; row++) {
       PROCESS_PAUSE();
 
       result = db_process(&handle);
@@ -43,7 +43,8 @@ typedef enum {
   INDEX_NONE = 0,
   INDEX_INLINE = 1,
   INDEX_MEMHASH = 2,
-  INDEX_MAXHEAP = 3
+  INDEX_MAXHEAP = 3,
+  INDEX_BPTREE = 4
 } index_type_t;
 
 #define INDEX_READY		0x00
@@ -55,6 +56,8 @@ typedef enum {
 #define INDEX_API_INLINE	0x04
 #define INDEX_API_COMPLETE	0x08
 #define INDEX_API_RANGE_QUERIES	0x10
+/* The index is built from the existing tuples when it is created. */
+#define INDEX_API_BULK_LOAD	0x20
 
 struct index_api;
 
@@ -77,12 +80,16 @@ struct index_iterator {
   attribute_value_t max_value;
   tuple_id_t next_item_no;
   tuple_id_t found_items;
+  /* The position of the iteration, in a format of the index type. */
+  uint32_t position;
 };
 typedef struct index_iterator index_iterator_t;
 
 struct index_api {
   index_type_t type;
   uint8_t flags;
+  /* The approximate number of storage accesses to look up a key. */
+  uint8_t cost;
   db_result_t (*create)(index_t *);
   db_result_t (*destroy)(index_t *);
   db_result_t (*load)(index_t *);
@@ -94,6 +101,7 @@ struct index_api {
 
 typedef struct index_api index_api_t;
 
+extern index_api_t index_bptree;
 extern index_api_t index_inline;
 extern index_api_t index_maxheap;
 extern index_api_t index_memhash;
@@ -66,6 +66,12 @@
 
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
+/* Instructions of a compiled program that are not operators. The
+   operators are stored as their operator_t value, which fits in a
+   byte. */
+#define PUSH_LONG			0x01
+#define PUSH_VARIABLE			0x02
+
 struct variable {
   operand_type_t type;
   operand_value_t value;
@@ -306,6 +312,7 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->end = 0;
   p->ip = 0;
   p->error = 0;
+  p->program_end = 0;
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
@@ -374,6 +381,184 @@ lvm_set_type(lvm_instance_t *p, node_type_t type)
 {
   *(node_type_t *)(p->code + p->end) = type;
   p->end += sizeof(type);
+  /* The code has changed, so a compiled program is out of date. */
+  p->program_end = 0;
+}
+
+static int
+emit(lvm_instance_t *p, const void *data, unsigned len)
+{
+  if(p->program_end + len > sizeof(p->program)) {
+    return 0;
+  }
+  memcpy(&p->program[p->program_end], data, len);
+  p->program_end += len;
+  return 1;
+}
+
+static int
+emit_op(lvm_instance_t *p, operator_t op)
+{
+  unsigned char byte;
+
+  byte = op;
+  return emit(p, &byte, 1);
+}
+
+/*
+ * Compile the node at p->ip and its operands into postfix order, which
+ * the program keeps on a stack of longs. The grammar is the one that
+ * eval_logic() and eval_expr() accept; depth is the stack depth before
+ * the node, and the function returns 0 if the node is invalid or the
+ * program would not fit.
+ */
+static int
+compile_node(lvm_instance_t *p, int depth)
+{
+  node_type_t type;
+  operator_t *operator;
+  operand_t operand;
+  unsigned char insn[1 + sizeof(long)];
+  long l;
+  int i;
+  int arguments;
+
+  if(depth >= LVM_STACK_SIZE) {
+    return 0;
+  }
+
+  type = get_type(p);
+  switch(type) {
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    if(operand.type == LVM_VARIABLE) {
+      insn[0] = PUSH_VARIABLE;
+      insn[1] = operand.value.id;
+      return emit(p, insn, 2);
+    }
+    l = operand_to_long(&operand);
+    insn[0] = PUSH_LONG;
+    memcpy(&insn[1], &l, sizeof(l));
+    return emit(p, insn, sizeof(insn));
+  case LVM_ARITH_OP:
+  case LVM_CMP_OP:
+    operator = get_operator(p);
+    arguments = *operator == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      if(IS_CONNECTIVE(*operator) && *(node_type_t *)(p->code + p->ip) != LVM_CMP_OP) {
+        return 0;
+      }
+      if(!IS_CONNECTIVE(*operator) && *(node_type_t *)(p->code + p->ip) == LVM_CMP_OP) {
+        return 0;
+      }
+      if(!compile_node(p, depth + i)) {
+        return 0;
+      }
+    }
+    return emit_op(p, *operator);
+  default:
+    return 0;
+  }
+}
+
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+  p->ip = 0;
+  p->program_end = 0;
+  if(p->end == 0 || *(node_type_t *)p->code != LVM_CMP_OP ||
+     !compile_node(p, 0) || p->ip != p->end) {
+    PRINTF("LVM: The code could not be compiled; interpreting it instead\n");
+    p->program_end = 0;
+    return SEMANTIC_ERROR;
+  }
+
+  PRINTF("LVM: Compiled %d bytes of code into %d bytes\n",
+         (int)p->end, (int)p->program_end);
+  return TRUE;
+}
+
+static lvm_status_t
+run_program(lvm_instance_t *p)
+{
+  long stack[LVM_STACK_SIZE];
+  long *sp;
+  unsigned char *pc;
+  unsigned char *end;
+
+  sp = stack;
+  pc = p->program;
+  end = p->program + p->program_end;
+
+  while(pc < end) {
+    switch(*pc++) {
+    case PUSH_LONG:
+      memcpy(sp++, pc, sizeof(long));
+      pc += sizeof(long);
+      break;
+    case PUSH_VARIABLE:
+      *sp++ = variables[*pc++].value.l;
+      break;
+    case LVM_ADD:
+      sp--;
+      sp[-1] += sp[0];
+      break;
+    case LVM_SUB:
+      sp--;
+      sp[-1] -= sp[0];
+      break;
+    case LVM_MUL:
+      sp--;
+      sp[-1] *= sp[0];
+      break;
+    case LVM_DIV:
+      sp--;
+      if(sp[0] == 0) {
+        return MATH_ERROR;
+      }
+      sp[-1] /= sp[0];
+      break;
+    case LVM_EQ:
+      sp--;
+      sp[-1] = sp[-1] == sp[0];
+      break;
+    case LVM_NEQ:
+      sp--;
+      sp[-1] = sp[-1] != sp[0];
+      break;
+    case LVM_GE:
+      sp--;
+      sp[-1] = sp[-1] > sp[0];
+      break;
+    case LVM_GEQ:
+      sp--;
+      sp[-1] = sp[-1] >= sp[0];
+      break;
+    case LVM_LE:
+      sp--;
+      sp[-1] = sp[-1] < sp[0];
+      break;
+    case LVM_LEQ:
+      sp--;
+      sp[-1] = sp[-1] <= sp[0];
+      break;
+    case LVM_AND:
+      sp--;
+      sp[-1] = sp[-1] && sp[0];
+      break;
+    case LVM_OR:
+      sp--;
+      sp[-1] = sp[-1] || sp[0];
+      break;
+    case LVM_NOT:
+      sp[-1] = !sp[-1];
+      break;
+    default:
+      return EXECUTION_ERROR;
+    }
+  }
+
+  return stack[0] ? TRUE : FALSE;
 }
 
 lvm_status_t
@@ -383,6 +568,10 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+  if(p->program_end > 0) {
+    return run_program(p);
+  }
+
   p->ip = 0;
   status = EXECUTION_ERROR;
   type = get_type(p);
@@ -472,6 +661,27 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+variable_id_t
+lvm_get_variable_id(char *name)
+{
+  variable_id_t id;
+
+  for(id = 0; id < sizeof(variables) / sizeof(variables[0]); id++) {
+    if(variables[id].name[0] != '\0' &&
+       strcmp(variables[id].name, name) == 0) {
+      return id;
+    }
+  }
+
+  return LVM_MAX_VARIABLE_ID;
+}
+
+void
+lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value)
+{
+  variables[id].value = value;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
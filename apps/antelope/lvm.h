@@ -69,6 +69,9 @@ struct lvm_instance {
   lvm_ip_t end;
   lvm_ip_t ip;
   unsigned error;
+  /* The predicate compiled by lvm_compile(), in postfix order. */
+  lvm_ip_t program_end;
+  unsigned char program[LVM_PROGRAM_SIZE];
 };
 typedef struct lvm_instance lvm_instance_t;
 
@@ -127,9 +130,12 @@ lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name,
                                    operand_value_t *min,
                                    operand_value_t *max);
 void lvm_print_derivations(lvm_instance_t *p);
+lvm_status_t lvm_compile(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
+variable_id_t lvm_get_variable_id(char *name);
+void lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value);
 void lvm_print_code(lvm_instance_t *p);
 lvm_ip_t lvm_jump_to_operand(lvm_instance_t *p);
 lvm_ip_t lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end);
@@ -37,6 +37,7 @@
 #include <limits.h>
 #include <string.h>
 
+#include "cfs/cfs.h"
 #include "lib/crc16.h"
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -64,6 +65,7 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+  variable_id_t variable_id;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
@@ -79,6 +81,65 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/* The join methods that relation_join() chooses between. */
+#define JOIN_INDEX	0
+#define JOIN_MERGE	1
+#define JOIN_HASH	2
+
+/* A tuple of the smaller relation in the hash table of a hash join. */
+struct join_entry {
+  long key;
+  tuple_id_t tuple_id;
+  uint16_t next;
+};
+
+/* A tuple written to a partition file by a hash join. */
+struct join_pair {
+  long key;
+  tuple_id_t tuple_id;
+};
+
+/*
+ * The state of a merge join or a hash join. A hash join builds a
+ * table over the smaller relation and probes it with the tuples of the
+ * larger one. If the smaller relation does not fit in the table, both
+ * relations are first partitioned into files by the hash of the join
+ * key, and the partitions are joined one at a time. A partition that
+ * still does not fit in the table is loaded in several chunks, each of
+ * which is probed with all tuples of the other partition.
+ */
+static struct {
+  uint8_t method;
+  uint8_t partitions;
+  uint8_t partition;
+  uint8_t probe_row_loaded;
+  uint8_t group_valid;
+  uint8_t files_open;
+  uint16_t entry;
+  relation_t *build_rel;
+  relation_t *probe_rel;
+  attribute_t *build_attr;
+  attribute_t *probe_attr;
+  unsigned char *build_row;
+  unsigned char *probe_row;
+  tuple_id_t build_pos;
+  tuple_id_t probe_pos;
+  tuple_id_t probe_tuple_id;
+  long probe_key;
+  tuple_id_t group_start;
+  long group_key;
+  db_storage_id_t build_fd;
+  db_storage_id_t probe_fd;
+  tuple_id_t counts[2][DB_JOIN_PARTITIONS];
+  char files[2][DB_JOIN_PARTITIONS][DB_MAX_FILENAME_LENGTH];
+} join;
+
+static struct join_entry join_entries[DB_JOIN_HASH_SIZE];
+static uint16_t join_buckets[DB_JOIN_HASH_BUCKETS];
+
+/* The merge join reads the right relation through a cursor of its own. */
+static storage_cursor_t join_cursor;
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -250,9 +311,14 @@ relation_load(char *name)
   list_add(relations, rel);
 
 end:
-  if(rel->dir == DB_STORAGE && DB_ERROR(storage_load(rel))) {
-    relation_release(rel);
-    return NULL;
+  if(rel->dir == DB_STORAGE) {
+    /* New tuples are numbered after the stored ones, to which the
+       indexes of the relation already refer. */
+    if(DB_ERROR(storage_load(rel)) ||
+       DB_ERROR(storage_get_row_amount(rel, &rel->next_row))) {
+      relation_release(rel);
+      return NULL;
+    }
   }
 
   return rel;
@@ -542,7 +608,9 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
   PRINTF(")\n");
 
-  rel->cardinality++;
+  if(rel->cardinality != INVALID_TUPLE) {
+    rel->cardinality++;
+  }
   rel->next_row++;
   return storage_put_row(rel, record);
 }
@@ -619,6 +687,9 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
     }
     attr_map_ptr->from_offset = offset;
     attr_map_ptr->to_offset = size_sum;
+    /* Bind the attribute to its predicate variable, if any, so that
+       the value can be set without a name lookup for each row. */
+    attr_map_ptr->variable_id = lvm_get_variable_id(to_attr->name);
 
     size_sum += to_attr->element_size;
     attr_map_ptr++;
@@ -636,26 +707,42 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   operand_value_t max;
   attribute_value_t av_min;
   attribute_value_t av_max;
-  long range;
-  unsigned long min_range;
+  unsigned long range;
+  unsigned long cost;
+  unsigned long min_cost;
+  index_api_t *api;
 
   index = NULL;
-  min_range = ULONG_MAX;
+  min_cost = ULONG_MAX;
 
-  /* Find all indexed and derived attributes, and select the index of 
-     the attribute with the smallest range. */
+  /* Find all indexed and derived attributes, and select the index
+     with the lowest estimated search cost. An index that supports
+     range queries pays its lookup cost once, and then a cost for each
+     value in the range that it scans. Other indexes look up each
+     value in the range separately. */
   for(attr = list_head(handle->rel->attributes);
       attr != NULL;
       attr = attr->next) {
     if(attr->index != NULL &&
        !LVM_ERROR(lvm_get_derived_range(lvm_instance, attr->name, &min, &max))) {
       range = (unsigned long)max.l - (unsigned long)min.l;
-      PRINTF("DB: The search range for attribute \"%s\" comprises %ld values\n",
+      PRINTF("DB: The search range for attribute \"%s\" comprises %lu values\n",
              attr->name, range + 1);
 
-      if(range <= min_range) {
+      api = ((index_t *)attr->index)->api;
+      if(range == ULONG_MAX) {
+        cost = ULONG_MAX;
+      } else if(api->flags & INDEX_API_RANGE_QUERIES) {
+        cost = range < ULONG_MAX - api->cost ? range + 1 + api->cost : ULONG_MAX;
+      } else {
+        cost = range < ULONG_MAX / (api->cost + 1) ?
+               (range + 1) * (api->cost + 1) : ULONG_MAX;
+      }
+
+      if(cost <= min_cost) {
+        min_cost = cost;
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -697,10 +784,21 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   }
 
   if(adt->lvm_instance != NULL) {
-    /* Try to establish acceptable ranges for the attribute values. */
-    if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
+    /* Try to establish acceptable ranges for the attribute values. An
+       index yields the tuples that match, so it cannot serve a removal,
+       which keeps the tuples that do not match. */
+    if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) &&
+       !LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
     }
+    /* Compile the predicate once, instead of walking its tree for
+       each row. */
+    lvm_compile(adt->lvm_instance);
+  }
+
+  if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) &&
+     DB_ERROR(storage_cursor_open(&handle->cursor, rel))) {
+    return DB_STORAGE_ERROR;
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
@@ -756,11 +854,9 @@ relation_process_select(void *handle_ptr)
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
-      PRINTF("DB: An attribute value could not be found in the index\n");
-      if(handle->index_iterator.next_item_no == 0) {
-        return DB_INDEX_ERROR;
-      }
-
+      /* The index has no more tuples in the range, which may have been
+         empty from the start. */
+      PRINTF("DB: No more matching tuples in the index\n");
       if(adt->flags & AQL_FLAG_AGGREGATE) {
         goto end_aggregation;
       }
@@ -771,7 +867,11 @@ relation_process_select(void *handle_ptr)
 
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
-  result = storage_get_row(handle->rel, &handle->tuple_id, row);
+  if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
+    result = storage_get_row(handle->rel, &handle->tuple_id, row);
+  } else {
+    result = storage_cursor_get_row(&handle->cursor, &handle->tuple_id, row);
+  }
   handle->tuple_id++;
   if(DB_ERROR(result)) {
     PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
@@ -789,15 +889,17 @@ relation_process_select(void *handle_ptr)
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
+    if(attr_map_ptr->variable_id == LVM_MAX_VARIABLE_ID) {
+      /* The attribute is not used in the predicate. */
+    } else if(result_attr->domain == DOMAIN_INT) {
       operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      lvm_set_variable_value_by_id(attr_map_ptr->variable_id, operand_value);
     } else if(result_attr->domain == DOMAIN_LONG) {
       operand_value.l = (uint32_t)from_ptr[0] << 24 |
                         (uint32_t)from_ptr[1] << 16 |
                         (uint32_t)from_ptr[2] << 8 |
                         from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      lvm_set_variable_value_by_id(attr_map_ptr->variable_id, operand_value);
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -959,24 +1061,63 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
-db_result_t
-relation_process_join(void *handle_ptr)
+static db_result_t
+join_emit(db_handle_t *handle)
 {
-  db_handle_t *handle;
-  db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
   relation_t *join_rel;
   unsigned char *join_next_attribute_ptr;
   size_t element_size;
+  int i;
+
+  join_rel = handle->join_rel;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+join_get_key(relation_t *rel, attribute_t *attr, unsigned char *row, long *key)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(relation_get_value(rel, attr, row, &value))) {
+    PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
+           attr->name);
+    return DB_IMPLEMENTATION_ERROR;
+  }
+
+  *key = db_value_to_long(&value);
+  return DB_OK;
+}
+
+static db_result_t
+index_join(db_handle_t *handle)
+{
+  db_result_t result;
+  relation_t *left_rel;
+  relation_t *right_rel;
   tuple_id_t right_tuple_id;
   attribute_value_t value;
-  int i;
 
-  handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
@@ -985,7 +1126,8 @@ relation_process_join(void *handle_ptr)
   /* Equi-join for indexed attributes only. In the outer loop, we iterate over
      each tuple in the left relation. */
   for(handle->tuple_id = 0;; handle->tuple_id++) {
-    result = storage_get_row(left_rel, &handle->tuple_id, left_row);
+    result = storage_cursor_get_row(&handle->cursor, &handle->tuple_id,
+                                    left_row);
     if(DB_ERROR(result)) {
       PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
       return result;
@@ -1030,31 +1172,444 @@ inner_loop:
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
+      return join_emit(handle);
+    }
+  }
+
+  return DB_OK;
+}
+
+/*
+ * The merge join requires that the rows of both relations are stored
+ * in ascending order of the join attribute, which is what an inline
+ * index presumes. Right rows with the same key form a group, which is
+ * scanned again for each left row with that key.
+ */
+static db_result_t
+merge_join(db_handle_t *handle)
+{
+  db_result_t result;
+  long left_key;
+  long right_key;
+
+  for(;;) {
+    result = storage_cursor_get_row(&handle->cursor, &handle->tuple_id,
+                                    left_row);
+    if(result != DB_OK) {
+      return result;
+    }
+    if(DB_ERROR(join_get_key(handle->left_rel, handle->left_join_attr,
+                             left_row, &left_key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+
+    result = storage_cursor_get_row(&join_cursor, &join.probe_pos, right_row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    if(result == DB_OK &&
+       DB_ERROR(join_get_key(handle->right_rel, handle->right_join_attr,
+                             right_row, &right_key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+
+    if(result == DB_OK && left_key == right_key) {
+      if(!join.group_valid || join.group_key != right_key) {
+        join.group_valid = 1;
+        join.group_key = right_key;
+        join.group_start = join.probe_pos;
+      }
+      join.probe_pos++;
+      return join_emit(handle);
+    }
+
+    if(result == DB_FINISHED || left_key < right_key) {
+      /* The left row has no more matches. Rewind to the start of the
+         last group if the next left row has the same key. */
+      handle->tuple_id++;
+      if(join.group_valid &&
+         storage_cursor_get_row(&handle->cursor, &handle->tuple_id,
+                                left_row) == DB_OK &&
+         !DB_ERROR(join_get_key(handle->left_rel, handle->left_join_attr,
+                                left_row, &left_key)) &&
+         left_key == join.group_key) {
+        join.probe_pos = join.group_start;
+      }
+    } else {
+      join.probe_pos++;
+    }
+  }
+}
+
+static unsigned
+join_hash(long key)
+{
+  /* Multiplicative hashing spreads consecutive keys over the table. */
+  return (unsigned)(((uint32_t)key * 2654435761UL) >> 16);
+}
+
+static void
+hash_join_cleanup(void)
+{
+  int side;
+  int i;
 
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
+  if(join.files_open) {
+    storage_close(join.build_fd);
+    storage_close(join.probe_fd);
+    join.files_open = 0;
+  }
 
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
+  for(side = 0; side < 2; side++) {
+    for(i = 0; i < DB_JOIN_PARTITIONS; i++) {
+      if(join.files[side][i][0] != '\0') {
+        cfs_remove(join.files[side][i]);
+        join.files[side][i][0] = '\0';
       }
+    }
+  }
+}
 
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
+/* Write the join key and tuple ID of each tuple in a relation to the
+   partition file chosen by the hash of the key. */
+static db_result_t
+hash_join_partition(db_handle_t *handle, int side, relation_t *rel,
+                    attribute_t *attr, unsigned char *rel_row)
+{
+  db_storage_id_t fds[DB_JOIN_PARTITIONS];
+  struct join_pair pair;
+  tuple_id_t cardinality;
+  db_result_t result;
+  char *filename;
+  unsigned partition;
+  int i;
+
+  for(i = 0; i < join.partitions; i++) {
+    fds[i] = -1;
+  }
+
+  cardinality = relation_cardinality(rel);
+
+  result = DB_STORAGE_ERROR;
+  for(i = 0; i < join.partitions; i++) {
+    filename = storage_generate_file("join",
+        (unsigned long)cardinality * sizeof(pair) / join.partitions);
+    if(filename == NULL) {
+      goto end;
+    }
+    memcpy(join.files[side][i], filename, sizeof(join.files[side][i]));
+    fds[i] = storage_open(join.files[side][i]);
+    if(fds[i] < 0) {
+      goto end;
+    }
+    join.counts[side][i] = 0;
+  }
+
+  if(DB_ERROR(storage_cursor_open(&handle->cursor, rel))) {
+    goto end;
+  }
+
+  for(pair.tuple_id = 0;; pair.tuple_id++) {
+    result = storage_cursor_get_row(&handle->cursor, &pair.tuple_id, rel_row);
+    if(result == DB_FINISHED) {
+      result = DB_OK;
+      break;
+    } else if(DB_ERROR(result) ||
+              DB_ERROR(result = join_get_key(rel, attr, rel_row, &pair.key))) {
+      goto end;
+    }
+
+    partition = join_hash(pair.key) / DB_JOIN_HASH_BUCKETS % join.partitions;
+    result = storage_write(fds[partition], &pair,
+                           join.counts[side][partition] * sizeof(pair),
+                           sizeof(pair));
+    if(DB_ERROR(result)) {
+      goto end;
+    }
+    join.counts[side][partition]++;
+  }
+
+end:
+  for(i = 0; i < join.partitions; i++) {
+    if(fds[i] >= 0) {
+      storage_close(fds[i]);
+    }
+  }
+  return result;
+}
+
+/* Fill the hash table with the next chunk of the smaller relation. */
+static db_result_t
+hash_join_load(db_handle_t *handle)
+{
+  struct join_pair pair;
+  struct join_entry *entry;
+  unsigned bucket;
+  uint16_t count;
+  db_result_t result;
+
+  memset(join_buckets, 0, sizeof(join_buckets));
+
+  if(join.partitions == 0 &&
+     DB_ERROR(storage_cursor_open(&handle->cursor, join.build_rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  for(count = 0; count < DB_JOIN_HASH_SIZE; count++, join.build_pos++) {
+    if(join.partitions == 0) {
+      pair.tuple_id = join.build_pos;
+      result = storage_cursor_get_row(&handle->cursor, &pair.tuple_id,
+                                      join.build_row);
+      if(result == DB_FINISHED) {
+        break;
+      } else if(DB_ERROR(result) ||
+                DB_ERROR(join_get_key(join.build_rel, join.build_attr,
+                                      join.build_row, &pair.key))) {
+        return DB_STORAGE_ERROR;
+      }
+    } else {
+      if(join.build_pos >= join.counts[0][join.partition]) {
+        break;
+      }
+      if(DB_ERROR(storage_read(join.build_fd, &pair,
+                               join.build_pos * sizeof(pair), sizeof(pair)))) {
+        return DB_STORAGE_ERROR;
+      }
+    }
+
+    entry = &join_entries[count];
+    entry->key = pair.key;
+    entry->tuple_id = pair.tuple_id;
+    bucket = join_hash(pair.key) % DB_JOIN_HASH_BUCKETS;
+    entry->next = join_buckets[bucket];
+    join_buckets[bucket] = count + 1;
+  }
+
+  PRINTF("DB: Loaded %u tuples into the hash table\n", (unsigned)count);
+
+  join.probe_pos = 0;
+  join.entry = 0;
+
+  if(join.partitions == 0 &&
+     DB_ERROR(storage_cursor_open(&handle->cursor, join.probe_rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  return DB_OK;
+}
+
+/* Step to the next chunk of the smaller relation that has tuples to
+   join with. */
+static db_result_t
+hash_join_next_chunk(db_handle_t *handle)
+{
+  if(join.partitions == 0) {
+    /* The whole relation was loaded in the first chunk. */
+    return DB_FINISHED;
+  }
+
+  while(join.build_pos >= join.counts[0][join.partition] ||
+        join.counts[1][join.partition] == 0) {
+    if(join.partition + 1 >= join.partitions) {
+      return DB_FINISHED;
+    }
+    join.partition++;
+    join.build_pos = 0;
+  }
+
+  if(join.build_pos == 0) {
+    if(join.files_open) {
+      storage_close(join.build_fd);
+      storage_close(join.probe_fd);
+      join.files_open = 0;
+    }
+    /* The partitions are only read from now on. */
+    join.build_fd = cfs_open(join.files[0][join.partition], CFS_READ);
+    join.probe_fd = cfs_open(join.files[1][join.partition], CFS_READ);
+    if(join.build_fd < 0 || join.probe_fd < 0) {
+      if(join.build_fd >= 0) {
+        storage_close(join.build_fd);
+      }
+      if(join.probe_fd >= 0) {
+        storage_close(join.probe_fd);
+      }
+      return DB_STORAGE_ERROR;
+    }
+    join.files_open = 1;
+  }
+
+  return hash_join_load(handle);
+}
+
+static db_result_t
+hash_join_probe_next(db_handle_t *handle)
+{
+  struct join_pair pair;
+  db_result_t result;
+
+  if(join.partitions == 0) {
+    result = storage_cursor_get_row(&handle->cursor, &join.probe_pos,
+                                    join.probe_row);
+    if(result != DB_OK) {
+      return result;
+    }
+    if(DB_ERROR(join_get_key(join.probe_rel, join.probe_attr,
+                             join.probe_row, &join.probe_key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+    join.probe_row_loaded = 1;
+  } else {
+    if(join.probe_pos >= join.counts[1][join.partition]) {
+      return DB_FINISHED;
+    }
+    if(DB_ERROR(storage_read(join.probe_fd, &pair,
+                             join.probe_pos * sizeof(pair), sizeof(pair)))) {
+      return DB_STORAGE_ERROR;
+    }
+    join.probe_key = pair.key;
+    join.probe_tuple_id = pair.tuple_id;
+    /* The row is read only if the key has a match. */
+    join.probe_row_loaded = 0;
+  }
+
+  join.probe_pos++;
+  join.entry = join_buckets[join_hash(join.probe_key) % DB_JOIN_HASH_BUCKETS];
+  return DB_OK;
+}
+
+static db_result_t
+hash_join(db_handle_t *handle)
+{
+  struct join_entry *entry;
+  tuple_id_t tuple_id;
+  db_result_t result;
+
+  for(;;) {
+    while(join.entry != 0) {
+      entry = &join_entries[join.entry - 1];
+      join.entry = entry->next;
+      if(entry->key != join.probe_key) {
+        continue;
+      }
+
+      tuple_id = entry->tuple_id;
+      if(storage_get_row(join.build_rel, &tuple_id, join.build_row) != DB_OK) {
+        result = DB_STORAGE_ERROR;
+        goto end;
+      }
+
+      if(!join.probe_row_loaded) {
+        tuple_id = join.probe_tuple_id;
+        if(storage_get_row(join.probe_rel, &tuple_id, join.probe_row) != DB_OK) {
+          result = DB_STORAGE_ERROR;
+          goto end;
         }
+        join.probe_row_loaded = 1;
       }
 
-      handle->current_row++;
-      return DB_GOT_ROW;
+      return join_emit(handle);
+    }
+
+    result = hash_join_probe_next(handle);
+    if(result == DB_FINISHED) {
+      result = hash_join_next_chunk(handle);
+    }
+    if(result != DB_OK) {
+      goto end;
+    }
+  }
+
+end:
+  hash_join_cleanup();
+  return result;
+}
+
+static db_result_t
+hash_join_setup(db_handle_t *handle)
+{
+  tuple_id_t build_cardinality;
+  db_result_t result;
+
+  /* Build the hash table over the smaller relation. */
+  if(relation_cardinality(handle->left_rel) <=
+     relation_cardinality(handle->right_rel)) {
+    join.build_rel = handle->left_rel;
+    join.build_attr = handle->left_join_attr;
+    join.build_row = left_row;
+    join.probe_rel = handle->right_rel;
+    join.probe_attr = handle->right_join_attr;
+    join.probe_row = right_row;
+  } else {
+    join.build_rel = handle->right_rel;
+    join.build_attr = handle->right_join_attr;
+    join.build_row = right_row;
+    join.probe_rel = handle->left_rel;
+    join.probe_attr = handle->left_join_attr;
+    join.probe_row = left_row;
+  }
+
+  build_cardinality = relation_cardinality(join.build_rel);
+  join.partitions = 0;
+  join.partition = 0;
+  join.build_pos = 0;
+
+  if(build_cardinality > DB_JOIN_HASH_SIZE) {
+    join.partitions = (build_cardinality + DB_JOIN_HASH_SIZE - 1) /
+                      DB_JOIN_HASH_SIZE;
+    if(join.partitions > DB_JOIN_PARTITIONS) {
+      join.partitions = DB_JOIN_PARTITIONS;
     }
+    PRINTF("DB: Partitioning the relations to join into %u files each\n",
+           (unsigned)join.partitions);
+
+    if(DB_ERROR(result = hash_join_partition(handle, 0, join.build_rel,
+                                             join.build_attr,
+                                             join.build_row)) ||
+       DB_ERROR(result = hash_join_partition(handle, 1, join.probe_rel,
+                                             join.probe_attr,
+                                             join.probe_row))) {
+      hash_join_cleanup();
+      return result;
+    }
+    result = hash_join_next_chunk(handle);
+  } else {
+    result = hash_join_load(handle);
+  }
+
+  if(DB_ERROR(result)) {
+    hash_join_cleanup();
+    return result;
+  }
+
+  if(result == DB_FINISHED) {
+    /* No partition has tuples from both relations. Probing the empty
+       table finishes the join at once. */
+    hash_join_cleanup();
+    join.partitions = 0;
+    join.probe_pos = INVALID_TUPLE;
+    join.entry = 0;
   }
 
   return DB_OK;
 }
 
+db_result_t
+relation_process_join(void *handle_ptr)
+{
+  db_handle_t *handle;
+
+  handle = (db_handle_t *)handle_ptr;
+
+  switch(join.method) {
+  case JOIN_MERGE:
+    return merge_join(handle);
+  case JOIN_HASH:
+    return hash_join(handle);
+  default:
+    return index_join(handle);
+  }
+}
+
 static db_result_t
 generate_join_result(db_handle_t *handle)
 {
@@ -1064,6 +1619,7 @@ generate_join_result(db_handle_t *handle)
   attribute_t *attr;
   attribute_t *result_attr;
   struct source_map *source_pair;
+  db_result_t result;
   int i;
   int offset;
   unsigned char *from_ptr;
@@ -1102,11 +1658,92 @@ generate_join_result(db_handle_t *handle)
     source_pair->from_ptr = from_ptr;
   }
 
+  switch(join.method) {
+  case JOIN_MERGE:
+    join.probe_pos = 0;
+    join.group_valid = 0;
+    if(DB_ERROR(storage_cursor_open(&join_cursor, right_rel))) {
+      return DB_STORAGE_ERROR;
+    }
+    /* Fall through. */
+  case JOIN_INDEX:
+    if(DB_ERROR(storage_cursor_open(&handle->cursor, left_rel))) {
+      return DB_STORAGE_ERROR;
+    }
+    break;
+  case JOIN_HASH:
+    result = hash_join_setup(handle);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    break;
+  }
+
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
   return DB_OK;
 }
 
+/*
+ * Choose the join method with the smallest estimated number of tuple
+ * and index accesses. The index join looks up each left tuple in the
+ * index of the right relation. The merge join reads both relations
+ * once, but requires that they are sorted by the join attribute. The
+ * hash join also reads both relations once if the smaller one fits in
+ * the hash table, and otherwise writes and reads each tuple once more
+ * to partition the relations.
+ */
+static db_result_t
+select_join_method(db_handle_t *handle)
+{
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  unsigned long cost;
+  unsigned long min_cost;
+  index_t *left_index;
+  index_t *right_index;
+
+  left_cardinality = relation_cardinality(handle->left_rel);
+  right_cardinality = relation_cardinality(handle->right_rel);
+  if(left_cardinality == INVALID_TUPLE || right_cardinality == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  join.method = JOIN_HASH;
+  min_cost = (unsigned long)left_cardinality + right_cardinality;
+  if(left_cardinality > DB_JOIN_HASH_SIZE &&
+     right_cardinality > DB_JOIN_HASH_SIZE) {
+    min_cost *= 3;
+  }
+
+  left_index = index_exists(handle->left_join_attr) ?
+               handle->left_join_attr->index : NULL;
+  right_index = index_exists(handle->right_join_attr) ?
+                handle->right_join_attr->index : NULL;
+
+  if(right_index != NULL) {
+    cost = (unsigned long)left_cardinality * right_index->api->cost;
+    if(cost <= min_cost) {
+      join.method = JOIN_INDEX;
+      min_cost = cost;
+    }
+  }
+
+  if(left_index != NULL && left_index->type == INDEX_INLINE &&
+     right_index != NULL && right_index->type == INDEX_INLINE) {
+    cost = (unsigned long)left_cardinality + right_cardinality;
+    if(cost <= min_cost) {
+      join.method = JOIN_MERGE;
+    }
+  }
+
+  PRINTF("DB: Joining %lu and %lu tuples with method %u\n",
+         (unsigned long)left_cardinality, (unsigned long)right_cardinality,
+         (unsigned)join.method);
+
+  return DB_OK;
+}
+
 db_result_t
 relation_join(void *query_result, void *adt_ptr)
 {
@@ -1129,6 +1766,10 @@ relation_join(void *query_result, void *adt_ptr)
   handle->adt = adt;
   handle->flags = DB_HANDLE_FLAG_INDEX_STEP;
 
+  /* Remove the partition files of a hash join that was not processed
+     to its end. */
+  hash_join_cleanup();
+
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
     name = adt->relations[0];
     dir = DB_STORAGE;
@@ -1158,9 +1799,18 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  /* The join methods compare the join attribute as an integer. */
+  if((handle->left_join_attr->domain != DOMAIN_INT &&
+      handle->left_join_attr->domain != DOMAIN_LONG) ||
+     (handle->right_join_attr->domain != DOMAIN_INT &&
+      handle->right_join_attr->domain != DOMAIN_LONG)) {
+    PRINTF("DB: Cannot join on the non-number attribute \"%s\"\n",
+           adt->attributes[0].name);
+    return DB_RELATIONAL_ERROR;
+  }
+
+  if(DB_ERROR(select_join_method(handle))) {
+    return DB_STORAGE_ERROR;
   }
 
   /*
@@ -52,6 +52,7 @@ typedef unsigned char *tuple_t;
 
 struct db_handle {
   index_iterator_t index_iterator;
+  storage_cursor_t cursor;
   tuple_id_t tuple_id;
   tuple_id_t current_row;
   relation_t *rel;
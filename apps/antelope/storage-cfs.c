@@ -508,6 +508,73 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
   return DB_OK;
 }
 
+db_result_t
+storage_cursor_open(storage_cursor_t *cursor, relation_t *rel)
+{
+  cursor->rel = rel;
+  cursor->first = 0;
+  cursor->count = 0;
+
+  return storage_get_row_amount(rel, &cursor->nrows);
+}
+
+db_result_t
+storage_cursor_get_row(storage_cursor_t *cursor, tuple_id_t *tuple_id,
+                       storage_row_t row)
+{
+  relation_t *rel;
+  tuple_id_t count;
+  int r;
+
+  rel = cursor->rel;
+
+  if(*tuple_id >= cursor->nrows) {
+    return DB_FINISHED;
+  }
+
+  if(*tuple_id < cursor->first ||
+     *tuple_id >= cursor->first + cursor->count) {
+    /* Refill the buffer, starting from the requested row. */
+    count = sizeof(cursor->buf) / rel->row_length;
+    if(count == 0) {
+      PRINTF("DB: A row of %u bytes does not fit in the scan buffer\n",
+             (unsigned)rel->row_length);
+      return DB_STORAGE_ERROR;
+    }
+    if(count > cursor->nrows - *tuple_id) {
+      count = cursor->nrows - *tuple_id;
+    }
+
+    if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length,
+                CFS_SEEK_SET) == (cfs_offset_t)-1) {
+      return DB_STORAGE_ERROR;
+    }
+
+    r = cfs_read(rel->tuple_storage, cursor->buf, count * rel->row_length);
+    if(r < 0) {
+      PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+      return DB_STORAGE_ERROR;
+    } else if(r == 0) {
+      return DB_FINISHED;
+    } else if(r < rel->row_length) {
+      PRINTF("DB: Incomplete record: %d < %d\n", r, rel->row_length);
+      return DB_STORAGE_ERROR;
+    }
+
+    cursor->first = *tuple_id;
+    cursor->count = r / rel->row_length;
+
+    PRINTF("DB: Read %lu rows from relation %s\n",
+           (unsigned long)cursor->count, rel->name);
+  }
+
+  memcpy(row, cursor->buf + (*tuple_id - cursor->first) * rel->row_length,
+         rel->row_length);
+  row[rel->row_length - 1] ^= ROW_XOR;
+
+  return DB_OK;
+}
+
 db_storage_id_t
 storage_open(const char *filename)
 {
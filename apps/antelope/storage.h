@@ -50,6 +50,18 @@
 
 typedef unsigned char * storage_row_t;
 
+/* A cursor for reading the rows of a relation in order. The rows are
+   read DB_SCAN_BUFFER_SIZE bytes at a time, and the row count is
+   taken once, when the cursor is opened. */
+struct storage_cursor {
+  relation_t *rel;
+  tuple_id_t nrows;
+  tuple_id_t first;
+  tuple_id_t count;
+  unsigned char buf[DB_SCAN_BUFFER_SIZE];
+};
+typedef struct storage_cursor storage_cursor_t;
+
 char *storage_generate_file(char *, unsigned long);
 
 db_result_t storage_load(relation_t *);
@@ -68,6 +80,10 @@ db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
 db_result_t storage_put_row(relation_t *, storage_row_t);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
+db_result_t storage_cursor_open(storage_cursor_t *, relation_t *);
+db_result_t storage_cursor_get_row(storage_cursor_t *, tuple_id_t *,
+                                   storage_row_t);
+
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
 db_result_t storage_read(db_storage_id_t, void *, unsigned long, unsigned);
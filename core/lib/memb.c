@@ -53,8 +53,66 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = 0;
+  m->fresh = 0;
+  m->used = 0;
+  m->max_used = 0;
+#endif /* MEMB_FREELIST */
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_FREELIST
+void *
+memb_alloc(struct memb *m)
+{
+  int i;
+
+  if(m->free != 0) {
+    /* Take the first block from the free list. */
+    i = m->free - 1;
+    m->free = m->next[i];
+  } else if(m->fresh < m->num) {
+    /* Take a block that has never been allocated. */
+    i = m->fresh++;
+  } else {
+    return NULL;
+  }
+
+  ++(m->count[i]);
+  if(++m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+  return (void *)((char *)m->mem + (i * m->size));
+}
+/*---------------------------------------------------------------------------*/
+char
+memb_free(struct memb *m, void *ptr)
+{
+  int i;
+  unsigned long offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+      /* Put the block first on the free list. */
+      m->next[i] = m->free;
+      m->free = i + 1;
+      --m->used;
+    }
+  }
+  return m->count[i];
+}
+#else /* MEMB_FREELIST */
 void *
 memb_alloc(struct memb *m)
 {
@@ -99,6 +157,7 @@ memb_free(struct memb *m, void *ptr)
   }
   return -1;
 }
+#endif /* MEMB_FREELIST */
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
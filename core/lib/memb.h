@@ -65,6 +65,25 @@
 
 #include "sys/cc.h"
 
+/**
+ * \brief Use a free list to allocate memory blocks.
+ *
+ *        By default, memb_alloc() and memb_free() search the memory
+ *        blocks, so their cost grows with the number of blocks. With
+ *        MEMB_CONF_FREELIST set to 1, every memory block declaration
+ *        also keeps a list of free blocks, which makes both functions
+ *        take constant time, at the cost of an extra unsigned short
+ *        per block. The free list is kept separate from the blocks,
+ *        so freed blocks are left untouched. The number of blocks in
+ *        use and its high-water mark are kept in the used and
+ *        max_used fields of struct memb.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
 /**
  * Declare a memory block.
  *
@@ -86,18 +105,39 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+#if MEMB_FREELIST
+#define MEMB(name, structure, num) \
+        static char CC_CONCAT(name,_memb_count)[num]; \
+        static structure CC_CONCAT(name,_memb_mem)[num]; \
+        static unsigned short CC_CONCAT(name,_memb_next)[num]; \
+        static struct memb name = {sizeof(structure), num, \
+                                          CC_CONCAT(name,_memb_count), \
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          CC_CONCAT(name,_memb_next)}
+#else /* MEMB_FREELIST */
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
                                           (void *)CC_CONCAT(name,_memb_mem)}
+#endif /* MEMB_FREELIST */
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREELIST
+  /* Free list, linked through next[] by block index + 1; 0 ends the
+     list. Blocks at or above fresh have never been allocated and are
+     not on the list, so that a zero-initialized memb is valid. */
+  unsigned short *next;
+  unsigned short free;
+  unsigned short fresh;
+  unsigned short used;
+  unsigned short max_used;
+#endif /* MEMB_FREELIST */
 };
 
 /**
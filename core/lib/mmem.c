@@ -55,8 +55,17 @@
 #define MMEM_SIZE 4096
 #endif
 
-LIST(mmemlist);
+#if MMEM_CONF_STATS
+struct mmem_stats mmem_stats;
+#define MMEM_STAT(code) (code)
+#else /* MMEM_CONF_STATS */
+#define MMEM_STAT(code)
+#endif /* MMEM_CONF_STATS */
+
 unsigned int avail_memory;
+
+#if !MMEM_SEGREGATED
+LIST(mmemlist);
 static char memory[MMEM_SIZE];
 
 /*---------------------------------------------------------------------------*/
@@ -82,8 +91,11 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+  MMEM_STAT(mmem_stats.allocs++);
+
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
+    MMEM_STAT(mmem_stats.failed_allocs++);
     return 0;
   }
 
@@ -120,7 +132,11 @@ mmem_free(struct mmem *m)
 {
   struct mmem *n;
 
+  MMEM_STAT(mmem_stats.frees++);
+
   if(m->next != NULL) {
+    MMEM_STAT(mmem_stats.bytes_moved +=
+              &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr);
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
     memmove(m->ptr, m->next->ptr,
@@ -155,5 +171,325 @@ mmem_init(void)
   avail_memory = MMEM_SIZE;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ * \param budget The maximum number of bytes to move
+ *
+ *             This function does nothing, because mmem_free() always
+ *             compacts the memory in this mode. It is provided so
+ *             that programs can call it regardless of which allocator
+ *             is configured.
+ *
+ */
+void
+mmem_compact(unsigned int budget)
+{
+}
+/*---------------------------------------------------------------------------*/
+#else /* !MMEM_SEGREGATED */
+
+
+#ifdef MMEM_CONF_COMPACT_STEP
+#define MMEM_COMPACT_STEP MMEM_CONF_COMPACT_STEP
+#else
+#define MMEM_COMPACT_STEP 64
+#endif
+
+#ifdef MMEM_CONF_CLASSES
+#define MMEM_CLASSES MMEM_CONF_CLASSES
+#else
+#define MMEM_CLASSES 8
+#endif
+
+/* Every block of memory, allocated or free, starts with a header. The
+   owner is the struct mmem that the block belongs to, or NULL if the
+   block is free. The size includes the header. */
+struct block {
+  struct mmem *owner;
+  unsigned int size;
+};
+
+/* Free blocks are also linked into the free list of their size
+   class. */
+struct free_block {
+  struct block hdr;
+  struct free_block *prev;
+  struct free_block *next;
+};
+
+/* Block sizes are multiples of the header size, so that every header
+   is aligned. */
+#define GRANULE     sizeof(struct block)
+#define ROUND(size) (((size) + GRANULE - 1) / GRANULE * GRANULE)
+#define MIN_BLOCK   ROUND(sizeof(struct free_block))
+#define HEAP_SIZE   (MMEM_SIZE / GRANULE * GRANULE)
+
+#define BLOCK_AT(offset) ((struct block *)&heap.memory[offset])
+#define OFFSET_OF(b)     ((unsigned int)((char *)(b) - heap.memory))
+
+static union {
+  struct block align;
+  char memory[MMEM_SIZE];
+} heap;
+
+/* Size class i holds free blocks of at least MIN_BLOCK << i bytes. */
+static struct free_block *free_lists[MMEM_CLASSES];
+
+/* The blocks are laid out back to back below top; the memory above
+   top is unused. All blocks below cursor are allocated and packed,
+   so compaction continues from there. */
+static unsigned int top;
+static unsigned int cursor;
+
+/* Compaction is only worth its cost when most of the free memory is
+   in blocks on the free lists rather than above top. */
+#define FRAGMENTED() (HEAP_SIZE - top < avail_memory / 2)
+/*---------------------------------------------------------------------------*/
+static int
+size_class(unsigned int size)
+{
+  int c;
+
+  for(c = 0; c < MMEM_CLASSES - 1 && size >= (MIN_BLOCK << (c + 1)); c++);
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_list_add(struct block *b)
+{
+  struct free_block *f = (struct free_block *)b;
+  int c;
+
+  c = size_class(b->size);
+  f->prev = NULL;
+  f->next = free_lists[c];
+  if(f->next != NULL) {
+    f->next->prev = f;
+  }
+  free_lists[c] = f;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_list_remove(struct block *b)
+{
+  struct free_block *f = (struct free_block *)b;
+
+  if(f->prev != NULL) {
+    f->prev->next = f->next;
+  } else {
+    free_lists[size_class(b->size)] = f->next;
+  }
+  if(f->next != NULL) {
+    f->next->prev = f->prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct block *
+free_list_find(unsigned int size)
+{
+  struct free_block *f;
+  int c;
+
+  /* The blocks in all classes above the first one are large enough,
+     so the search normally ends at the head of a list. */
+  for(c = size_class(size); c < MMEM_CLASSES; c++) {
+    for(f = free_lists[c]; f != NULL; f = f->next) {
+      if(f->hdr.size >= size) {
+        return &f->hdr;
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Allocate a managed memory block
+ * \param m    A pointer to a struct mmem.
+ * \param size The size of the requested memory block
+ * \return     Non-zero if the memory could be allocated, zero if memory
+ *             was not available.
+ *
+ *             This function allocates a chunk of managed memory. The
+ *             memory allocated with this function must be deallocated
+ *             using the mmem_free() function. No other block is moved
+ *             by this function. If the free memory is too fragmented
+ *             for the request, it fails; the program may then call
+ *             mmem_compact() and try again.
+ *
+ */
+int
+mmem_alloc(struct mmem *m, unsigned int size)
+{
+  struct block *b, *rest;
+  unsigned int need;
+
+  MMEM_STAT(mmem_stats.allocs++);
+
+  need = ROUND(sizeof(struct block) + size);
+  if(need < MIN_BLOCK) {
+    need = MIN_BLOCK;
+  }
+  if(avail_memory < need) {
+    MMEM_STAT(mmem_stats.failed_allocs++);
+    return 0;
+  }
+
+  b = free_list_find(need);
+  if(b != NULL) {
+    free_list_remove(b);
+    if(b->size - need >= MIN_BLOCK) {
+      /* Split the block and keep the rest on a free list. */
+      rest = (struct block *)((char *)b + need);
+      rest->owner = NULL;
+      rest->size = b->size - need;
+      free_list_add(rest);
+      b->size = need;
+    }
+  } else {
+    if(HEAP_SIZE - top < need) {
+      /* There is enough free memory, but it is fragmented. */
+      MMEM_STAT(mmem_stats.failed_allocs++);
+      return 0;
+    }
+    b = BLOCK_AT(top);
+    b->size = need;
+    top += need;
+  }
+
+  b->owner = m;
+  m->ptr = b + 1;
+  m->size = size;
+  avail_memory -= b->size;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Deallocate a managed memory block
+ * \param m    A pointer to the managed memory block
+ *
+ *             This function deallocates a managed memory block that
+ *             previously has been allocated with mmem_alloc(). The
+ *             block is merged with any free blocks that follow it and
+ *             put on a free list. If the free memory is fragmented, at
+ *             most MMEM_CONF_COMPACT_STEP bytes of other blocks are
+ *             moved.
+ *
+ */
+void
+mmem_free(struct mmem *m)
+{
+  struct block *b, *n;
+  unsigned int offset;
+
+  MMEM_STAT(mmem_stats.frees++);
+
+  b = (struct block *)m->ptr - 1;
+  offset = OFFSET_OF(b);
+  avail_memory += b->size;
+  b->owner = NULL;
+
+  while(offset + b->size < top) {
+    n = BLOCK_AT(offset + b->size);
+    if(n->owner != NULL) {
+      break;
+    }
+    free_list_remove(n);
+    b->size += n->size;
+  }
+
+  if(offset + b->size == top) {
+    top = offset;
+  } else {
+    free_list_add(b);
+  }
+  if(cursor > offset) {
+    cursor = offset;
+  }
+
+  if(FRAGMENTED()) {
+    mmem_compact(MMEM_COMPACT_STEP);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ * \param budget The maximum number of bytes to move
+ *
+ *             This function moves allocated blocks downwards into
+ *             free space, continuing where the previous call left
+ *             off, until about budget bytes have been moved or
+ *             inspected. mmem_free() calls it with a small budget; a
+ *             program may call it when it is idle to compact the
+ *             memory ahead of time, or with a budget of at least
+ *             MMEM_CONF_SIZE to make room for an allocation that
+ *             failed. Any block may be moved, so pointers obtained
+ *             with MMEM_PTR() must be fetched again afterwards.
+ *
+ */
+void
+mmem_compact(unsigned int budget)
+{
+  struct block *b, *n;
+  unsigned int gap, cost;
+
+  while(cursor < top && budget > 0) {
+    b = BLOCK_AT(cursor);
+    if(b->owner != NULL) {
+      cursor += b->size;
+      cost = sizeof(struct block);
+    } else {
+      /* Collect the free blocks here into a single gap. */
+      free_list_remove(b);
+      gap = b->size;
+      while(cursor + gap < top && BLOCK_AT(cursor + gap)->owner == NULL) {
+        n = BLOCK_AT(cursor + gap);
+        free_list_remove(n);
+        gap += n->size;
+      }
+      if(cursor + gap == top) {
+        top = cursor;
+        return;
+      }
+
+      /* Move the next allocated block down over the gap. */
+      n = BLOCK_AT(cursor + gap);
+      cost = n->size;
+      memmove(b, n, n->size);
+      b->owner->ptr = b + 1;
+      cursor += b->size;
+      MMEM_STAT(mmem_stats.bytes_moved += cost);
+
+      b = BLOCK_AT(cursor);
+      b->owner = NULL;
+      b->size = gap;
+      free_list_add(b);
+    }
+    budget = cost < budget ? budget - cost : 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Initialize the managed memory module
+ *
+ *             This function initializes the managed memory module and
+ *             should be called before any other function from the
+ *             module.
+ *
+ */
+void
+mmem_init(void)
+{
+  int c;
+
+  for(c = 0; c < MMEM_CLASSES; c++) {
+    free_lists[c] = NULL;
+  }
+  top = 0;
+  cursor = 0;
+  avail_memory = HEAP_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* !MMEM_SEGREGATED */
 
 /** @} */
@@ -59,6 +59,44 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
+/**
+ * \brief Use the segregated managed memory allocator.
+ *
+ *        By default, mmem_free() compacts the memory immediately by
+ *        moving all blocks that follow the freed block, so freeing a
+ *        block near the start of a large heap costs time proportional
+ *        to the heap size. With MMEM_CONF_SEGREGATED set to 1, freed
+ *        blocks are instead kept on free lists segregated by size
+ *        class and reused by later allocations, and the memory is
+ *        compacted incrementally: while more than half of the free
+ *        memory is fragmented, each call to mmem_free() moves at
+ *        most MMEM_CONF_COMPACT_STEP bytes. As in the default mode,
+ *        mmem_alloc() never moves blocks, so it fails if the free
+ *        memory is too fragmented for the request; mmem_compact()
+ *        then makes room. Every block has a header holding its owner
+ *        and size, so a given MMEM_CONF_SIZE holds less data in this
+ *        mode.
+ */
+#ifdef MMEM_CONF_SEGREGATED
+#define MMEM_SEGREGATED MMEM_CONF_SEGREGATED
+#else /* MMEM_CONF_SEGREGATED */
+#define MMEM_SEGREGATED 0
+#endif /* MMEM_CONF_SEGREGATED */
+
+#if MMEM_CONF_STATS
+struct mmem_stats {
+  unsigned long allocs;
+  unsigned long failed_allocs;
+  unsigned long frees;
+  /* Bytes moved by compaction. */
+  unsigned long bytes_moved;
+};
+
+extern struct mmem_stats mmem_stats;
+#endif /* MMEM_CONF_STATS */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -86,6 +124,7 @@ struct mmem {
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_compact(unsigned int budget);
 
 #endif /* MMEM_H_ */
 
@@ -41,6 +41,7 @@
 #include "contiki-net.h"
 #include "net/ip/uip-split.h"
 #include "net/ip/uip-packetqueue.h"
+#include "net/packetbuf.h"
 
 #if UIP_CONF_IPV6
 #include "net/ipv6/uip-nd6.h"
@@ -413,7 +414,7 @@ eventhandler(process_event_t ev, process_data_t data)
         for(cptr = &uip_udp_conns[0];
             cptr < &uip_udp_conns[UIP_UDP_CONNS]; ++cptr) {
           if(cptr->appstate.p == p) {
-            cptr->lport = 0;
+            uip_udp_remove(cptr);
           }
         }
       }
@@ -536,6 +537,28 @@ tcpip_input(void)
 }
 /*---------------------------------------------------------------------------*/
 #if UIP_CONF_IPV6
+/* Mark neighbor discovery, RPL control messages and TCP segments
+   without payload as control traffic, so that a queueing MAC can send
+   them ahead of data. Only packets without extension headers are
+   recognized. */
+static void
+set_tx_priority(void)
+{
+  uint8_t priority = PACKETBUF_ATTR_PRIORITY_DATA;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_ICMP6) {
+    uint8_t type = ((struct uip_icmp_hdr *)&uip_buf[UIP_LLIPH_LEN])->type;
+    if((type >= ICMP6_RS && type <= ICMP6_REDIRECT) || type == ICMP6_RPL) {
+      priority = PACKETBUF_ATTR_PRIORITY_CONTROL;
+    }
+  } else if(UIP_IP_BUF->proto == UIP_PROTO_TCP) {
+    if(uip_len <= UIP_IPH_LEN + ((UIP_TCP_BUF->tcpoffset >> 4) << 2)) {
+      priority = PACKETBUF_ATTR_PRIORITY_CONTROL;
+    }
+  }
+  packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY, priority);
+}
+/*---------------------------------------------------------------------------*/
 void
 tcpip_ipv6_output(void)
 {
@@ -702,6 +725,7 @@ tcpip_ipv6_output(void)
       }
 #endif /* UIP_ND6_SEND_NA */
 
+      set_tx_priority();
       tcpip_output(uip_ds6_nbr_get_ll(nbr));
 
 #if UIP_CONF_IPV6_QUEUE_PKT
@@ -715,6 +739,7 @@ tcpip_ipv6_output(void)
         uip_len = uip_packetqueue_buflen(&nbr->packethandle);
         memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
         uip_packetqueue_free(&nbr->packethandle);
+        set_tx_priority();
         tcpip_output(uip_ds6_nbr_get_ll(nbr));
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
@@ -725,6 +750,7 @@ tcpip_ipv6_output(void)
     return;
   }
   /* Multicast IP destination address. */
+  set_tx_priority();
   tcpip_output(NULL);
   uip_len = 0;
   uip_ext_len = 0;
@@ -795,6 +821,8 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+  process_set_priority(&tcpip_process, PROCESS_PRIORITY_NETWORK);
   
 #if UIP_TCP
  {
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum
+ */
+
+#include <string.h>
+
+#include "net/ip/uip-chksum.h"
+
+/*---------------------------------------------------------------------------*/
+#if UIP_CHKSUM_WIDE
+/* Sum 32-bit words in the native byte order. The result is the
+   checksum of the data as 16-bit words in network byte order, except
+   that its bytes are swapped on little-endian CPUs. The words are
+   copied with memcpy(), which the compiler turns into plain loads
+   where unaligned access is allowed. */
+static uint16_t
+sum_words(const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+  uint32_t w[4];
+
+  acc = 0;
+  while(len >= sizeof(w)) {
+    memcpy(w, data, sizeof(w));
+    acc += (uint64_t)w[0] + w[1] + w[2] + w[3];
+    data += sizeof(w);
+    len -= sizeof(w);
+  }
+  while(len >= sizeof(w[0])) {
+    memcpy(w, data, sizeof(w[0]));
+    acc += w[0];
+    data += sizeof(w[0]);
+    len -= sizeof(w[0]);
+  }
+
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  return (uint16_t)acc;
+}
+#endif /* UIP_CHKSUM_WIDE */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint32_t acc;
+  const uint8_t *last_byte;
+
+  /* The carries are collected in the upper half of the accumulator
+     and folded back in at the end. */
+  acc = sum;
+
+#if UIP_CHKSUM_WIDE
+  acc += uip_htons(sum_words(data, len & ~3));
+  data += len & ~3;
+  len &= 3;
+#endif /* UIP_CHKSUM_WIDE */
+
+  last_byte = data + len - 1;
+  while(data < last_byte) {     /* At least two more bytes */
+    acc += ((uint16_t)data[0] << 8) + data[1];
+    data += 2;
+  }
+  if(data == last_byte) {
+    acc += (uint16_t)data[0] << 8;
+  }
+
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Return sum in host byte order. */
+  return (uint16_t)acc;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_update16(uint16_t chksum, uint16_t oldval, uint16_t newval)
+{
+  uint32_t acc;
+
+  acc = (uint16_t)~chksum;
+  acc += (uint16_t)~oldval;
+  acc += newval;
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  return ~(uint16_t)acc;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_adjust(uint16_t chksum, uint16_t oldsum, uint16_t newsum)
+{
+  return uip_chksum_update16(chksum, uip_htons(oldsum), uip_htons(newsum));
+}
+/*---------------------------------------------------------------------------*/
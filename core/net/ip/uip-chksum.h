@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup uipchksum uIP Internet checksum
+ * @{
+ *
+ * The one's complement Internet checksum, shared by the IPv4 and IPv6
+ * stacks and by ip64. Besides computing checksums over data, the
+ * module can update a checksum when a few fields of a packet change,
+ * as described in RFC 1624, so that a router that rewrites addresses
+ * or ports does not need to sum the whole packet again.
+ */
+
+/**
+ * \file
+ *         Header file for the Internet checksum
+ */
+
+#ifndef UIP_CHKSUM_H_
+#define UIP_CHKSUM_H_
+
+#include "net/ip/uip.h"
+
+/**
+ * \brief      Add data to a partial checksum
+ * \param sum  The partial checksum so far, 0 to start a new one
+ * \param data A pointer to the data
+ * \param len  The length of the data, in bytes
+ * \return     The partial checksum, in host byte order
+ *
+ *             The data is summed as 16-bit words in network byte
+ *             order, so it must start at an even offset from the
+ *             start of the data that the checksum covers. An odd
+ *             length is padded with a zero byte.
+ *
+ *             The result is zero only if all data was zero. The
+ *             checksum field of a packet is set to the complement of
+ *             the partial checksum in network byte order.
+ */
+uint16_t uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * \brief        Update a checksum for a changed 16-bit field
+ * \param chksum The checksum field of the packet
+ * \param oldval The old value of the field
+ * \param newval The new value of the field
+ * \return       The new checksum field
+ *
+ *               All arguments are in the byte order of the packet,
+ *               so the fields can be passed as they are. This
+ *               computes HC' = ~(~HC + ~m + m') from RFC 1624.
+ */
+uint16_t uip_chksum_update16(uint16_t chksum, uint16_t oldval,
+                             uint16_t newval);
+
+/**
+ * \brief        Update a checksum for changed data
+ * \param chksum The checksum field of the packet
+ * \param oldsum The partial checksum of the data that was removed
+ * \param newsum The partial checksum of the data that replaced it
+ * \return       The new checksum field
+ *
+ *               The partial checksums are computed with
+ *               uip_chksum_add(). The old and new data need not have
+ *               the same length, which allows a translator to replace
+ *               a pseudo header with one of another protocol.
+ */
+uint16_t uip_chksum_adjust(uint16_t chksum, uint16_t oldsum,
+                           uint16_t newsum);
+
+#endif /* UIP_CHKSUM_H_ */
+
+/** @} */
+/** @} */
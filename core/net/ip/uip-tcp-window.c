@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The uIP TCP retransmission queue.
+ */
+
+#include <string.h>
+
+#include "net/ip/uip-tcp-window.h"
+#include "net/ip/tcpip.h"
+#include "lib/memb.h"
+
+#if UIP_TCP_WINDOW
+
+struct uip_tcp_segment {
+  struct uip_tcp_segment *next;
+  uint16_t len;
+  uint8_t data[UIP_TCP_MSS];
+};
+
+MEMB(segment_memb, struct uip_tcp_segment, UIP_TCP_WINDOW_BUFFERS);
+
+/* The number of duplicate ACKs that triggers a fast retransmit. */
+#define DUPACK_THRESHOLD 3
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq_get(const uint8_t *seq)
+{
+  return ((uint32_t)seq[0] << 24) | ((uint32_t)seq[1] << 16) |
+    ((uint32_t)seq[2] << 8) | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+seq_put(uint8_t *seq, uint32_t value)
+{
+  seq[0] = value >> 24;
+  seq[1] = value >> 16;
+  seq[2] = value >> 8;
+  seq[3] = value;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_reset(struct uip_conn *conn)
+{
+  struct uip_tcp_segment *seg;
+
+  while(conn->rtxq != NULL) {
+    seg = conn->rtxq;
+    conn->rtxq = seg->next;
+    memb_free(&segment_memb, seg);
+  }
+  conn->nseg = 0;
+  conn->dupacks = 0;
+  conn->wflags = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_open(struct uip_conn *conn)
+{
+  return conn->nseg < UIP_TCP_WINDOW_SEGMENTS &&
+    !(conn->wflags & (UIP_TCPW_RECOVERY | UIP_TCPW_CLOSEPENDING));
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_push(struct uip_conn *conn, const void *data, uint16_t len)
+{
+  struct uip_tcp_segment *seg, **tail;
+
+  if(conn->wflags & UIP_TCPW_ACKPENDING) {
+    /* The application has not been told that its previous data was
+       queued, so this is that same data again. */
+    return 0;
+  }
+
+  /* As in the single-segment mode, one segment may always be sent if
+     nothing is in flight, even into a closed window. */
+  seg = NULL;
+  if(uip_tcp_window_open(conn) &&
+     (conn->len == 0 || (uint32_t)conn->len + len <= conn->snd_wnd)) {
+    seg = memb_alloc(&segment_memb);
+  }
+  if(seg == NULL) {
+    conn->wflags |= UIP_TCPW_REXMITPENDING;
+    return 0;
+  }
+
+  seg->next = NULL;
+  seg->len = len;
+  memcpy(seg->data, data, len);
+  for(tail = &conn->rtxq; *tail != NULL; tail = &(*tail)->next);
+  *tail = seg;
+  conn->nseg++;
+  conn->len += len;
+
+  conn->wflags &= ~UIP_TCPW_REXMITPENDING;
+  conn->wflags |= UIP_TCPW_ACKPENDING;
+
+  /* Let the application send more data right away, rather than at
+     the next periodic poll. */
+  if(uip_tcp_window_open(conn)) {
+    tcpip_poll_tcp(conn);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_ack(struct uip_conn *conn, const uint8_t *ackno,
+                   uint16_t datalen)
+{
+  struct uip_tcp_segment *seg;
+  uint32_t acked;
+
+  acked = seq_get(ackno) - seq_get(conn->snd_nxt);
+
+  if(acked == 0) {
+    if(datalen == 0 && ++conn->dupacks == DUPACK_THRESHOLD) {
+      conn->wflags |= UIP_TCPW_RECOVERY | UIP_TCPW_REXMIT;
+    }
+    return 0;
+  }
+  if(acked > conn->len) {
+    /* An old ACK, or one for data that we have not sent. */
+    return 0;
+  }
+
+  seq_put(conn->snd_nxt, seq_get(conn->snd_nxt) + acked);
+  conn->len -= acked;
+  conn->dupacks = 0;
+
+  while(acked > 0) {
+    seg = conn->rtxq;
+    if(acked < seg->len) {
+      /* Only a part of the segment was acknowledged. */
+      seg->len -= acked;
+      memmove(seg->data, &seg->data[acked], seg->len);
+      break;
+    }
+    acked -= seg->len;
+    conn->rtxq = seg->next;
+    conn->nseg--;
+    memb_free(&segment_memb, seg);
+  }
+
+  if(conn->rtxq == NULL) {
+    conn->wflags &= ~UIP_TCPW_RECOVERY;
+  } else if(conn->wflags & UIP_TCPW_RECOVERY) {
+    /* The receiver may have dropped the segments that followed the
+       lost one, so resend the next one too. */
+    conn->wflags |= UIP_TCPW_REXMIT;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_window_rexmit(struct uip_conn *conn, void *buf)
+{
+  conn->wflags &= ~UIP_TCPW_REXMIT;
+  if(conn->rtxq == NULL) {
+    return 0;
+  }
+  memcpy(buf, conn->rtxq->data, conn->rtxq->len);
+  return conn->rtxq->len;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+uip_tcp_window_appflags(struct uip_conn *conn)
+{
+  if(!uip_tcp_window_open(conn)) {
+    return 0;
+  }
+  if(conn->wflags & UIP_TCPW_ACKPENDING) {
+    conn->wflags &= ~UIP_TCPW_ACKPENDING;
+    return UIP_ACKDATA;
+  }
+  if(conn->wflags & UIP_TCPW_REXMITPENDING) {
+    conn->wflags &= ~UIP_TCPW_REXMITPENDING;
+    return UIP_REXMIT;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_TCP_WINDOW */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup uiptcpwindow uIP TCP retransmission queue
+ * @{
+ *
+ * With UIP_CONF_TCP_WINDOW_SEGMENTS set to more than one, uIP keeps
+ * a copy of each TCP segment it sends in a per-connection
+ * retransmission queue, so that a connection may have several
+ * segments in flight. The segments are stored in a pool of
+ * UIP_CONF_TCP_WINDOW_BUFFERS buffers shared by all connections.
+ *
+ * In this mode, the len field of struct uip_conn holds the number of
+ * bytes in flight, and snd_nxt holds the sequence number of the
+ * oldest unacknowledged byte. The application still sends data with
+ * uip_send(), but it is told that its data has been acknowledged as
+ * soon as the data has been queued, and it is only asked to
+ * retransmit data that could not be queued.
+ */
+
+/**
+ * \file
+ *         Header file for the uIP TCP retransmission queue.
+ */
+
+#ifndef UIP_TCP_WINDOW_H_
+#define UIP_TCP_WINDOW_H_
+
+#include "net/ip/uip.h"
+
+/* Flags in the wflags field of struct uip_conn. */
+#define UIP_TCPW_ACKPENDING    0x01 /* The application's data was queued,
+                                       but it has not been told yet. */
+#define UIP_TCPW_REXMITPENDING 0x02 /* The application's data could not
+                                       be queued and must be sent again. */
+#define UIP_TCPW_RECOVERY      0x04 /* Retransmitting after a loss. */
+#define UIP_TCPW_REXMIT        0x08 /* Retransmit the oldest segment. */
+#define UIP_TCPW_CLOSEPENDING  0x10 /* Send a FIN once all data has been
+                                       acknowledged. */
+
+/**
+ * Discard the retransmission queue of a connection.
+ */
+void uip_tcp_window_reset(struct uip_conn *conn);
+
+/**
+ * Check if a connection can queue another segment.
+ */
+int uip_tcp_window_open(struct uip_conn *conn);
+
+/**
+ * Queue a segment of data from the application.
+ *
+ * \return Non-zero if the data was queued and should be sent, zero
+ * if the data must not be sent now.
+ */
+int uip_tcp_window_push(struct uip_conn *conn, const void *data,
+                        uint16_t len);
+
+/**
+ * Process the acknowledgment number of an incoming segment.
+ *
+ * \param datalen The length of the data in the incoming segment.
+ * \return Non-zero if the segment acknowledged new data.
+ */
+int uip_tcp_window_ack(struct uip_conn *conn, const uint8_t *ackno,
+                       uint16_t datalen);
+
+/**
+ * Copy the oldest unacknowledged segment into a buffer.
+ *
+ * \return The length of the segment.
+ */
+uint16_t uip_tcp_window_rexmit(struct uip_conn *conn, void *buf);
+
+/**
+ * Get the UIP_ACKDATA or UIP_REXMIT flag that the application should
+ * be called with, if any.
+ */
+uint8_t uip_tcp_window_appflags(struct uip_conn *conn);
+
+#endif /* UIP_TCP_WINDOW_H_ */
+
+/** @} */
+/** @} */
@@ -745,6 +745,13 @@ CCIF void uip_send(const void *data, int len);
  * acknowledged by the remote host. This means that the application
  * can send new data.
  *
+ * With UIP_CONF_TCP_WINDOW_SEGMENTS set to more than one, this is
+ * instead non-zero as soon as uIP has copied the previously sent data
+ * into its retransmission queue, before the remote host has
+ * acknowledged it. uIP then retransmits the data itself, so
+ * uip_acked() does not mean that the remote host has received the
+ * data.
+ *
  * \hideinitializer
  */
 #define uip_acked()   (uip_flags & UIP_ACKDATA)
@@ -799,6 +806,10 @@ CCIF void uip_send(const void *data, int len);
  * application should send the exact same data as it did the last
  * time, using the uip_send() function.
  *
+ * With UIP_CONF_TCP_WINDOW_SEGMENTS set to more than one, this only
+ * happens when the data could not be queued, since uIP retransmits
+ * queued data itself.
+ *
  * \hideinitializer
  */
 #define uip_rexmit()     (uip_flags & UIP_REXMIT)
@@ -867,6 +878,23 @@ CCIF void uip_send(const void *data, int len);
  */
 struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
 
+#if UIP_CONN_HASH
+/**
+ * Change the local port of a UDP connection.
+ *
+ * With connection hash tables, the local port of a UDP connection
+ * must only be changed with this function, which is used by
+ * uip_udp_bind() and uip_udp_remove().
+ *
+ * \param conn A pointer to the uip_udp_conn structure for the
+ * connection.
+ *
+ * \param lport The local port number, in network byte order, or zero
+ * to remove the connection.
+ */
+void uip_udp_set_lport(struct uip_udp_conn *conn, uint16_t lport);
+#endif /* UIP_CONN_HASH */
+
 /**
  * Remove a UDP connection.
  *
@@ -874,7 +902,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+#define uip_udp_remove(conn) uip_udp_set_lport(conn, 0)
+#else /* UIP_CONN_HASH */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_CONN_HASH */
 
 /**
  * Bind a UDP connection to a local port.
@@ -886,7 +918,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+#define uip_udp_bind(conn, port) uip_udp_set_lport(conn, port)
+#else /* UIP_CONN_HASH */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_CONN_HASH */
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1334,6 +1370,8 @@ extern uint16_t uip_urglen, uip_surglen;
  * file pointers) for the connection. The type of this field is
  * configured in the "uipopt.h" header file.
  */
+struct uip_tcp_segment;
+
 struct uip_conn {
   uip_ipaddr_t ripaddr;   /**< The IP address of the remote host. */
 
@@ -1359,6 +1397,22 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_TCP_WINDOW
+  struct uip_tcp_segment *rtxq; /**< The segments that have been sent
+                                   but not acknowledged, oldest
+                                   first. */
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint8_t nseg;          /**< The number of segments in rtxq. */
+  uint8_t dupacks;       /**< The number of duplicate ACKs received. */
+  uint8_t wflags;        /**< Retransmission queue state flags. */
+#endif /* UIP_TCP_WINDOW */
+
+#if UIP_CONN_HASH
+  struct uip_conn *hnext; /**< The next connection in the same
+                             hash bucket. */
+  struct uip_conn *pnext; /**< The next connection in the same
+                             local port hash bucket. */
+#endif /* UIP_CONN_HASH */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -1398,6 +1452,11 @@ struct uip_udp_conn {
   uint16_t rport;        /**< The remote port number in network byte order. */
   uint8_t  ttl;          /**< Default time-to-live. */
 
+#if UIP_CONN_HASH
+  struct uip_udp_conn *hnext; /**< The next connection in the same
+                                 hash bucket. */
+#endif /* UIP_CONN_HASH */
+
   /** The application state. */
   uip_udp_appstate_t appstate;
 };
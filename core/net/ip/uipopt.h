@@ -435,6 +435,26 @@ void uip_log(char *msg);
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * The number of buckets in the hash tables that uIPv6 uses to find
+ * the TCP connection or UDP connection that an incoming packet
+ * belongs to, and to check if a local port is in use.
+ *
+ * If zero, all connections are searched instead. A hash table is
+ * worthwhile with many connections; it requires two pointers per
+ * bucket plus two pointers per TCP connection and one pointer per
+ * UDP connection.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH_SIZE
+#define UIP_CONN_HASH_SIZE (UIP_CONF_CONN_HASH_SIZE)
+#else /* UIP_CONF_CONN_HASH_SIZE */
+#define UIP_CONN_HASH_SIZE 0
+#endif /* UIP_CONF_CONN_HASH_SIZE */
+
+#define UIP_CONN_HASH (UIP_CONF_IPV6 && UIP_CONN_HASH_SIZE > 0)
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -511,6 +531,40 @@ void uip_log(char *msg);
 #define UIP_TIME_WAIT_TIMEOUT UIP_CONF_WAIT_TIMEOUT
 #endif
 
+/**
+ * The number of TCP segments that a connection may have in flight.
+ *
+ * By default, uIP only allows a single unacknowledged segment per
+ * connection and asks the application to retransmit it. With a value
+ * larger than one, uIP keeps a copy of every segment it sends in a
+ * retransmission queue, so that the application can send new data
+ * before the previous data has been acknowledged. uIP then does
+ * retransmissions itself, including fast retransmit after three
+ * duplicate ACKs. From the application's point of view, uip_acked()
+ * becomes true as soon as its data has been queued.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_SEGMENTS
+#define UIP_TCP_WINDOW_SEGMENTS UIP_CONF_TCP_WINDOW_SEGMENTS
+#else /* UIP_CONF_TCP_WINDOW_SEGMENTS */
+#define UIP_TCP_WINDOW_SEGMENTS 1
+#endif /* UIP_CONF_TCP_WINDOW_SEGMENTS */
+
+#define UIP_TCP_WINDOW (UIP_TCP && UIP_TCP_WINDOW_SEGMENTS > 1)
+
+/**
+ * The number of segment buffers, of UIP_TCP_MSS bytes each, that are
+ * shared by the retransmission queues of all TCP connections.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_BUFFERS
+#define UIP_TCP_WINDOW_BUFFERS UIP_CONF_TCP_WINDOW_BUFFERS
+#else /* UIP_CONF_TCP_WINDOW_BUFFERS */
+#define UIP_TCP_WINDOW_BUFFERS UIP_TCP_WINDOW_SEGMENTS
+#endif /* UIP_CONF_TCP_WINDOW_BUFFERS */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 /**
@@ -570,6 +624,28 @@ void uip_log(char *msg);
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of packets that can be reassembled in parallel at the 6lowpan
+ * layer. Each one uses a buffer of UIP_BUFSIZE bytes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
+/**
+ * Number of fragmented packets that a router can forward in parallel
+ * fragment by fragment, without reassembling them first. Packets that
+ * cannot be forwarded this way are reassembled as usual. (default: 0,
+ * always reassemble)
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING (SICSLOWPAN_CONF_FRAG_FORWARDING)
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -619,6 +695,21 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum 32 bits at a time.
+ *
+ * By default, the checksum is computed 16 bits at a time, which suits
+ * 8-bit and 16-bit CPUs. On 32-bit and 64-bit CPUs, summing 32-bit
+ * words into a 64-bit accumulator is considerably faster.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_WIDE
+#define UIP_CHKSUM_WIDE    (UIP_CONF_CHKSUM_WIDE)
+#else /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CHKSUM_WIDE    0
+#endif /* UIP_CONF_CHKSUM_WIDE */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
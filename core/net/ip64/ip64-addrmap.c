@@ -32,6 +32,7 @@
 
 #include "lib/memb.h"
 #include "lib/list.h"
+#include "sys/ctimer.h"
 
 #include "ip64-conf.h"
 
@@ -43,9 +44,32 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* The number of hash buckets in each of the two lookup indices. */
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE NUM_ENTRIES
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+/* How often expired mappings are removed. Lookups never return an
+   expired mapping, so this only determines how long an expired
+   mapping may occupy an entry before it is freed. */
+#ifdef IP64_ADDRMAP_CONF_AGE_INTERVAL
+#define AGE_INTERVAL IP64_ADDRMAP_CONF_AGE_INTERVAL
+#else /* IP64_ADDRMAP_CONF_AGE_INTERVAL */
+#define AGE_INTERVAL (CLOCK_SECOND * 10)
+#endif /* IP64_ADDRMAP_CONF_AGE_INTERVAL */
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+/* Mappings are indexed by their IPv6-side tuple, for packets from the
+   inside, and by their mapped port, for packets from the outside. */
+static struct ip64_addrmap_entry *tuple_hash[HASH_SIZE];
+static struct ip64_addrmap_entry *port_hash[HASH_SIZE];
+
+static struct ctimer age_timer;
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
@@ -64,28 +88,85 @@ ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+  memset(tuple_hash, 0, sizeof(tuple_hash));
+  memset(port_hash, 0, sizeof(port_hash));
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static unsigned int
+tuple_hash_index(const uip_ip6addr_t *ip6addr, uint16_t ip6port,
+                 const uip_ip4addr_t *ip4addr, uint16_t ip4port,
+                 uint8_t protocol)
+{
+  unsigned int h;
+  int i;
+
+  /* The interface identifier is the part of the IPv6 address that
+     differs between hosts on the inside network. */
+  h = protocol;
+  for(i = 8; i < 16; i++) {
+    h = h * 31 + ip6addr->u8[i];
+  }
+  for(i = 0; i < 4; i++) {
+    h = h * 31 + ip4addr->u8[i];
+  }
+  h = h * 31 + ip6port;
+  h = h * 31 + ip4port;
+  return h % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+port_hash_index(uint16_t port)
+{
+  return port % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  p = &tuple_hash[tuple_hash_index(&m->ip6addr, m->ip6port,
+                                   &m->ip4addr, m->ip4port, m->protocol)];
+  while(*p != m) {
+    p = &(*p)->tuple_next;
+  }
+  *p = m->tuple_next;
+
+  p = &port_hash[port_hash_index(m->mapped_port)];
+  while(*p != m) {
+    p = &(*p)->port_next;
+  }
+  *p = m->port_next;
+
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+}
+/*---------------------------------------------------------------------------*/
 static void
 check_age(void)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next;
 
   /* Walk through the list of address mappings, throw away the ones
      that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
+  for(m = list_head(entrylist); m != NULL; m = next) {
+    next = list_item_next(m);
     if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
-    } else {
-      m = list_item_next(m);
+      remove_entry(m);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+age_timer_callback(void *ptr)
+{
+  check_age();
+  if(list_head(entrylist) != NULL) {
+    ctimer_reset(&age_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static int
 recycle(void)
 {
@@ -114,8 +195,7 @@ recycle(void)
   /* If we found an oldest recyclable entry, remove it and return
      non-zero. */
   if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
+    remove_entry(oldest);
     return 1;
   }
 
@@ -133,19 +213,20 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 
   printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
 	 uip_htons(ip6port));
-  check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
-	   m->protocol, protocol,
-	   m->ip4port, ip4port,
-	   m->ip6port, ip6port,
-	   uip_ip4addr_cmp(&m->ip4addr, ip4addr),
-	   uip_ip6addr_cmp(&m->ip6addr, ip6addr));
+  for(m = tuple_hash[tuple_hash_index(ip6addr, ip6port,
+                                      ip4addr, ip4port, protocol)];
+      m != NULL;
+      m = m->tuple_next) {
     if(m->protocol == protocol &&
        m->ip4port == ip4port &&
        m->ip6port == ip6port &&
        uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
        uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
+      if(timer_expired(&m->timer)) {
+        /* The mapping expired but has not been removed yet. */
+        remove_entry(m);
+        return NULL;
+      }
       return m;
     }
   }
@@ -157,19 +238,34 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
 
-  check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("mapped port %d %d, protocol %d %d\n",
-	   m->mapped_port, mapped_port,
-	   m->protocol, protocol);
+  for(m = port_hash[port_hash_index(mapped_port)];
+      m != NULL;
+      m = m->port_next) {
     if(m->mapped_port == mapped_port &&
        m->protocol == protocol) {
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        return NULL;
+      }
       return m;
     }
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static int
+mapped_port_in_use(uint16_t port)
+{
+  struct ip64_addrmap_entry *m;
+
+  for(m = port_hash[port_hash_index(port)]; m != NULL; m = m->port_next) {
+    if(m->mapped_port == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 increase_mapped_port(void)
 {
@@ -187,13 +283,16 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
+  unsigned int h;
 
-  check_age();
   m = memb_alloc(&entrymemb);
   if(m == NULL) {
-    /* We could not allocate an entry, try to recycle one and try to
-       allocate again. */
-    if(recycle()) {
+    /* We could not allocate an entry. Throw away the expired ones,
+       or if there are none, try to recycle one, and try to allocate
+       again. */
+    check_age();
+    m = memb_alloc(&entrymemb);
+    if(m == NULL && recycle()) {
       m = memb_alloc(&entrymemb);
     }
   }
@@ -209,22 +308,24 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    while(mapped_port_in_use(mapped_port)) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
+    h = tuple_hash_index(ip6addr, ip6port, ip4addr, ip4port, protocol);
+    m->tuple_next = tuple_hash[h];
+    tuple_hash[h] = m;
+    h = port_hash_index(m->mapped_port);
+    m->port_next = port_hash[h];
+    port_hash[h] = m;
+
     list_add(entrylist, m);
+
+    if(ctimer_expired(&age_timer)) {
+      ctimer_set(&age_timer, AGE_INTERVAL, age_timer_callback, NULL);
+    }
     return m;
   }
   return NULL;
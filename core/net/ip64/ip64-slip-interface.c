@@ -93,10 +93,10 @@ input_callback(void)
        packet back if no route is found */
     uip_ipaddr_copy(&last_sender, &UIP_IP_BUF->srcipaddr);
     
-    uint16_t len = ip64_4to6(&uip_buf[UIP_LLH_LEN], uip_len, 
-			     ip64_packet_buffer);
+    /* Translate the packet within uip_buf. */
+    uint16_t len = ip64_4to6(&uip_buf[UIP_LLH_LEN], uip_len,
+			     &uip_buf[UIP_LLH_LEN]);
     if(len > 0) {
-      memcpy(&uip_buf[UIP_LLH_LEN], ip64_packet_buffer, len);
       uip_len = len;
       /*      PRINTF("send len %d\n", len); */
     } else {
@@ -130,13 +130,13 @@ output(void)
   if(uip_ipaddr_cmp(&last_sender, &UIP_IP_BUF->srcipaddr)) {
     PRINTF("ip64-interface: output, not sending bounced message\n");
   } else {
+    /* Translate the packet in place and send it from where it
+       ends up. */
     len = ip64_6to4(&uip_buf[UIP_LLH_LEN], uip_len,
-		    ip64_packet_buffer);
+		    &uip_buf[UIP_LLH_LEN + IP64_HDRLEN_DIFF]);
     PRINTF("ip64-interface: output len %d\n", len);
     if(len > 0) {
-      memcpy(&uip_buf[UIP_LLH_LEN], ip64_packet_buffer, len);
-      uip_len = len;
-      slip_send();
+      slip_write(&uip_buf[UIP_LLH_LEN + IP64_HDRLEN_DIFF], len);
     }
   }
 }
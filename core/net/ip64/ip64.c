@@ -61,6 +61,7 @@
 
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
+#include "net/ip/uip-chksum.h"
 
 #include "net/ip/uip-debug.h"
 
@@ -265,42 +266,11 @@ ip64_set_ipv6_address(const uip_ip6addr_t *addr)
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
-static uint16_t
 ipv4_checksum(struct ipv4_hdr *hdr)
 {
   uint16_t sum;
 
-  sum = chksum(0, (uint8_t *)hdr, IPV4_HDRLEN);
+  sum = uip_chksum_add(0, (uint8_t *)hdr, IPV4_HDRLEN);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
@@ -319,14 +289,14 @@ ipv4_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
     /* IP protocol and length fields. This addition cannot carry. */
     sum = transport_layer_len + proto;
     /* Sum IP source and destination addresses. */
-    sum = chksum(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+    sum = uip_chksum_add(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
   } else {
     /* ping replies' checksums are calculated over the icmp-part only */
     sum = 0;
   }
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV4_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV4_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -345,15 +315,31 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = transport_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
-  sum = chksum(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV6_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV6_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
+/* Update the transport layer checksum of a translated packet. The
+   protocol and the transport layer length are the same in the IPv6
+   and IPv4 pseudo headers, so only the addresses and the translated
+   port number differ from the original packet. */
+static uint16_t
+translated_checksum(uint16_t chksum,
+                    const void *oldaddrs, uint16_t oldaddrlen,
+                    const void *newaddrs, uint16_t newaddrlen,
+                    uint16_t oldport, uint16_t newport)
+{
+  chksum = uip_chksum_adjust(chksum,
+                             uip_chksum_add(0, oldaddrs, oldaddrlen),
+                             uip_chksum_add(0, newaddrs, newaddrlen));
+  return uip_chksum_update16(chksum, oldport, newport);
+}
+/*---------------------------------------------------------------------------*/
 int
 ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 	  uint8_t *resultpacket)
@@ -364,7 +350,9 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct tcp_hdr *tcphdr;
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
+  struct ipv6_hdr v6copy;
   uint16_t ipv6len, ipv4len;
+  uint16_t srcport, icmpword;
   struct ip64_addrmap_entry *m;
   
   v6hdr = (struct ipv6_hdr *)ipv6packet;
@@ -377,16 +365,30 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     return 0;
   }
 
-  /* We copy the data from the IPv6 packet into the IPv4 packet. We do
-     not modify the data in any way. */
-  memcpy(&resultpacket[IPV4_HDRLEN],
-	 &ipv6packet[IPV6_HDRLEN],
-	 ipv6len - IPV6_HDRLEN);
+  /* The IPv4 packet may be written over the IPv6 packet, so we work
+     from a copy of the IPv6 header. */
+  memcpy(&v6copy, ipv6packet, IPV6_HDRLEN);
+  v6hdr = &v6copy;
+
+  /* We move the data from the IPv6 packet into the IPv4 packet,
+     unless the IPv4 packet was placed IP64_HDRLEN_DIFF bytes into the
+     IPv6 packet, where the data already is. We do not modify the data
+     in any way. */
+  if(&resultpacket[IPV4_HDRLEN] != &ipv6packet[IPV6_HDRLEN]) {
+    memmove(&resultpacket[IPV4_HDRLEN],
+            &ipv6packet[IPV6_HDRLEN],
+            ipv6len - IPV6_HDRLEN);
+  }
 
   udphdr = (struct udp_hdr *)&resultpacket[IPV4_HDRLEN];
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV4_HDRLEN];
   icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV4_HDRLEN];
-  icmpv6hdr = (struct icmpv6_hdr *)&ipv6packet[IPV6_HDRLEN];
+  icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV4_HDRLEN];
+
+  /* Remember the fields that are rewritten below, for the checksum
+     update. */
+  srcport = udphdr->srcport;
+  icmpword = uip_htons(icmpv6hdr->type << 8 | icmpv6hdr->icode);
 
   /* Translate the IPv6 header into an IPv4 header. */
 
@@ -420,27 +422,11 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   case IP_PROTO_TCP:
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
-
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
-    }
-
     break;
 
   case IP_PROTO_UDP:
     PRINTF("ip64_6to4: UDP header\n");
     v4hdr->proto = IP_PROTO_UDP;
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
-    }
     break;
 
   case IP_PROTO_ICMPV6:
@@ -594,25 +580,51 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 
   /* The checksum is in different places in the different protocol
      headers, so we need to be sure that we update the correct
-     field. */
+     field. The TCP and UDP checksums are updated for the fields that
+     were translated rather than computed over the whole packet. This
+     also means that a packet that was corrupted on the IPv6 side
+     still has a bad checksum on the IPv4 side. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_TCP));
+    tcphdr->tcpchksum = translated_checksum(tcphdr->tcpchksum,
+                                            &v6hdr->srcipaddr,
+                                            2 * sizeof(uip_ip6addr_t),
+                                            &v4hdr->srcipaddr,
+                                            2 * sizeof(uip_ip4addr_t),
+                                            srcport,
+                                            tcphdr->srcport);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(udphdr->udpchksum == 0) {
+      /* The checksum is mandatory in IPv6, but compute it if the
+         sender left it out. */
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+                                                    IP_PROTO_UDP));
+    } else {
+      udphdr->udpchksum = translated_checksum(udphdr->udpchksum,
+                                              &v6hdr->srcipaddr,
+                                              2 * sizeof(uip_ip6addr_t),
+                                              &v4hdr->srcipaddr,
+                                              2 * sizeof(uip_ip4addr_t),
+                                              srcport,
+                                              udphdr->srcport);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
     break;
   case IP_PROTO_ICMPV4:
-    icmpv4hdr->icmpchksum = 0;
-    icmpv4hdr->icmpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						      IP_PROTO_ICMPV4));
+    /* The ICMPv4 checksum has no pseudo header, so the IPv6 pseudo
+       header is taken out along with the old message type. */
+    icmpv4hdr->icmpchksum =
+      uip_chksum_adjust(icmpv4hdr->icmpchksum,
+                        uip_chksum_add(ipv4len - IPV4_HDRLEN + IP_PROTO_ICMPV6,
+                                       (uint8_t *)&v6hdr->srcipaddr,
+                                       2 * sizeof(uip_ip6addr_t)),
+                        0);
+    icmpv4hdr->icmpchksum =
+      uip_chksum_update16(icmpv4hdr->icmpchksum, icmpword,
+                          uip_htons(icmpv4hdr->type << 8 | icmpv4hdr->icode));
     break;
 
   default:
@@ -635,7 +647,9 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct tcp_hdr *tcphdr;
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
+  struct ipv4_hdr v4copy;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
+  uint16_t destport, icmpword;
   struct ip64_addrmap_entry *m;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
@@ -658,16 +672,30 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     PRINTF("ip64_4to6: packet too big to fit in buffer, dropping\n");
     return 0;
   }
-  /* We copy the data from the IPv4 packet into the IPv6 packet. */
-  memcpy(&resultpacket[IPV6_HDRLEN],
-	 &ipv4packet[IPV4_HDRLEN],
-	 ipv4len - IPV4_HDRLEN);
+  /* The IPv6 packet may be written over the IPv4 packet, so we work
+     from a copy of the IPv4 header. */
+  memcpy(&v4copy, ipv4packet, IPV4_HDRLEN);
+  v4hdr = &v4copy;
+
+  /* We move the data from the IPv4 packet into the IPv6 packet,
+     unless the IPv6 packet was placed IP64_HDRLEN_DIFF bytes in front
+     of the IPv4 packet, where the data already is. */
+  if(&resultpacket[IPV6_HDRLEN] != &ipv4packet[IPV4_HDRLEN]) {
+    memmove(&resultpacket[IPV6_HDRLEN],
+            &ipv4packet[IPV4_HDRLEN],
+            ipv4len - IPV4_HDRLEN);
+  }
   
   udphdr = (struct udp_hdr *)&resultpacket[IPV6_HDRLEN];
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV6_HDRLEN];
-  icmpv4hdr = (struct icmpv4_hdr *)&ipv4packet[IPV4_HDRLEN];
+  icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV6_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV6_HDRLEN];
 
+  /* Remember the fields that are rewritten below, for the checksum
+     update. */
+  destport = udphdr->destport;
+  icmpword = uip_htons(icmpv4hdr->type << 8 | icmpv4hdr->icode);
+
   ipv6len = ipv4len - IPV4_HDRLEN + IPV6_HDRLEN;
   ipv6_packet_len = ipv6len - IPV6_HDRLEN;
 
@@ -817,26 +845,46 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_TCP));
+    tcphdr->tcpchksum = translated_checksum(tcphdr->tcpchksum,
+                                            &v4hdr->srcipaddr,
+                                            2 * sizeof(uip_ip4addr_t),
+                                            &v6hdr->srcipaddr,
+                                            2 * sizeof(uip_ip6addr_t),
+                                            destport,
+                                            tcphdr->destport);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(udphdr->udpchksum == 0) {
+      /* The checksum is optional in IPv4 but mandatory in IPv6. */
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                                                    ipv6len,
+                                                    IP_PROTO_UDP));
+    } else {
+      udphdr->udpchksum = translated_checksum(udphdr->udpchksum,
+                                              &v4hdr->srcipaddr,
+                                              2 * sizeof(uip_ip4addr_t),
+                                              &v6hdr->srcipaddr,
+                                              2 * sizeof(uip_ip6addr_t),
+                                              destport,
+                                              udphdr->destport);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
     break;
 
   case IP_PROTO_ICMPV6:
-    icmpv6hdr->icmpchksum = 0;
-    icmpv6hdr->icmpchksum = ~(ipv6_transport_checksum(resultpacket,
-                                                ipv6len,
-                                                IP_PROTO_ICMPV6));
+    /* The ICMPv6 checksum adds a pseudo header to what the ICMPv4
+       checksum covered. */
+    icmpv6hdr->icmpchksum =
+      uip_chksum_adjust(icmpv6hdr->icmpchksum,
+                        0,
+                        uip_chksum_add(ipv6_packet_len + IP_PROTO_ICMPV6,
+                                       (uint8_t *)&v6hdr->srcipaddr,
+                                       2 * sizeof(uip_ip6addr_t)));
+    icmpv6hdr->icmpchksum =
+      uip_chksum_update16(icmpv6hdr->icmpchksum, icmpword,
+                          uip_htons(icmpv6hdr->type << 8 | icmpv6hdr->icode));
     break;
   default:
     PRINTF("ip64_4to6: transport protocol %d not implemented\n", v4hdr->proto);
@@ -34,6 +34,14 @@
 #include "net/ip/uip.h"
 
 void ip64_init(void);
+
+/* The result packet of ip64_6to4() and ip64_4to6() may overlap the
+   packet that is translated. An IPv6 packet at p is translated in
+   place into an IPv4 packet at p + IP64_HDRLEN_DIFF, and an IPv4
+   packet at p into an IPv6 packet at p - IP64_HDRLEN_DIFF, without
+   moving the payload. Any other placement moves the payload once. */
+#define IP64_HDRLEN_DIFF 20
+
 int ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6len,
 	      uint8_t *resultpacket);
 int ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4len,
@@ -72,6 +72,8 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-tcp-window.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ipv4/uip_arp.h"
 #include "net/ip/uip_arch.h"
 
@@ -145,6 +147,13 @@ uint16_t uip_len, uip_slen;
 				depending on the maximum packet
 				size. */
 
+#if UIP_TCP_WINDOW
+/* The offset from snd_nxt of the sequence number of the next segment
+   that is sent. TCP_SEQOFF_DEFAULT means after all data in flight. */
+#define TCP_SEQOFF_DEFAULT 0xffff
+static uint16_t tcp_seqoff = TCP_SEQOFF_DEFAULT;
+#endif /* UIP_TCP_WINDOW */
+
 uint8_t uip_flags;     /* The uip_flags variable is used for
 				communication between the TCP/IP stack
 				and the application program. */
@@ -267,41 +276,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -310,7 +288,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   DEBUG_PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -333,10 +311,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
 	       upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -447,6 +425,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
 
   conn->len = 1;   /* TCP length of the SYN is one. */
   conn->nrtx = 0;
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(conn);
+#endif /* UIP_TCP_WINDOW */
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
   conn->sa = 0;
@@ -685,9 +666,18 @@ uip_process(uint8_t flag)
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
+#if UIP_TCP_WINDOW
+    if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+       uip_tcp_window_open(uip_connr)) {
+	uip_flags = uip_tcp_window_appflags(uip_connr);
+	if(uip_flags == 0) {
+	  uip_flags = UIP_POLL;
+	}
+#else /* UIP_TCP_WINDOW */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
 	uip_flags = UIP_POLL;
+#endif /* UIP_TCP_WINDOW */
 	UIP_APPCALL();
 	goto appsend;
 #if UIP_ACTIVE_OPEN && UIP_TCP
@@ -742,6 +732,9 @@ uip_process(uint8_t flag)
 	       uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
 	      uip_connr->nrtx == UIP_MAXSYNRTX)) {
 	    uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+	    uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 
 	    /* We call UIP_APPCALL() with uip_flags set to
 	       UIP_TIMEDOUT to inform the application that the
@@ -781,6 +774,13 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
 	  case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW
+	    /* With a retransmission queue, we retransmit the oldest
+	       segment ourselves and stop sending new data until all
+	       queued data has been acknowledged. */
+	    uip_connr->wflags |= UIP_TCPW_RECOVERY;
+	    goto tcp_send_rexmit;
+#else /* UIP_TCP_WINDOW */
 	    /* In the ESTABLISHED state, we call upon the application
                to do the actual retransmit after which we jump into
                the code for sending out the packet (the apprexmit
@@ -788,6 +788,7 @@ uip_process(uint8_t flag)
 	    uip_flags = UIP_REXMIT;
 	    UIP_APPCALL();
 	    goto apprexmit;
+#endif /* UIP_TCP_WINDOW */
 
 	  case UIP_FIN_WAIT_1:
 	  case UIP_CLOSING:
@@ -797,10 +798,23 @@ uip_process(uint8_t flag)
 
 	  }
 	}
+#if UIP_TCP_WINDOW
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	 uip_tcp_window_open(uip_connr)) {
+	/* If there was no need for a retransmission, we poll the
+	   application for new data, also if there is data in
+	   flight. */
+	uip_flags = uip_tcp_window_appflags(uip_connr);
+	if(uip_flags == 0) {
+	  uip_flags = UIP_POLL;
+	}
+#else /* UIP_TCP_WINDOW */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
 	/* If there was no need for a retransmission, we poll the
            application for new data. */
 	uip_flags = UIP_POLL;
+#endif /* UIP_TCP_WINDOW */
 	UIP_APPCALL();
 	goto appsend;
       }
@@ -1372,6 +1386,9 @@ uip_process(uint8_t flag)
   uip_connr->snd_nxt[2] = iss[2];
   uip_connr->snd_nxt[3] = iss[3];
   uip_connr->len = 1;
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 
   /* rcv_nxt should be the seqno from the incoming packet + 1. */
   uip_connr->rcv_nxt[3] = BUF->seqno[3];
@@ -1445,6 +1462,9 @@ uip_process(uint8_t flag)
      before we accept the reset. */
   if(BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1480,6 +1500,44 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_WINDOW
+  if(BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)BUF->wnd[0] << 8) + BUF->wnd[1];
+  }
+  /* If data segments are in flight, the retransmission queue handles
+     the ACK. It does not set UIP_ACKDATA; the application is told
+     when its data was queued instead. */
+  if((BUF->flags & TCP_ACK) && uip_connr->rtxq != NULL) {
+    if(uip_tcp_window_ack(uip_connr, BUF->ackno, uip_len)) {
+      /* Do RTT estimation, unless we have done retransmissions. */
+      if(uip_connr->nrtx == 0 &&
+	 !(uip_connr->wflags & UIP_TCPW_RECOVERY)) {
+	signed char m;
+	m = uip_connr->rto - uip_connr->timer;
+	m = m - (uip_connr->sa >> 3);
+	uip_connr->sa += m;
+	if(m < 0) {
+	  m = -m;
+	}
+	m = m - (uip_connr->sv >> 2);
+	uip_connr->sv += m;
+	uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
+      }
+      uip_connr->timer = uip_connr->rto;
+      uip_connr->nrtx = 0;
+
+      /* Send the FIN that the application asked for once all data has
+	 been acknowledged. */
+      if(uip_connr->rtxq == NULL &&
+	 (uip_connr->wflags & UIP_TCPW_CLOSEPENDING)) {
+	uip_connr->wflags &= ~UIP_TCPW_CLOSEPENDING;
+	uip_connr->len = 1;
+	uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
+	goto tcp_send_finack;
+      }
+    }
+  } else
+#endif /* UIP_TCP_WINDOW */
   if((BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1705,7 +1763,10 @@ uip_process(uint8_t flag)
        put into the uip_appdata and the length of the data should be
        put into uip_len. If the application don't have any data to
        send, uip_len must be set to 0. */
-    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+#if UIP_TCP_WINDOW
+    uip_flags |= uip_tcp_window_appflags(uip_connr);
+#endif /* UIP_TCP_WINDOW */
+    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT)) {
       uip_slen = 0;
       UIP_APPCALL();
 
@@ -1714,12 +1775,23 @@ uip_process(uint8_t flag)
       if(uip_flags & UIP_ABORT) {
 	uip_slen = 0;
 	uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+	uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 	BUF->flags = TCP_RST | TCP_ACK;
 	goto tcp_send_nodata;
       }
 
       if(uip_flags & UIP_CLOSE) {
 	uip_slen = 0;
+#if UIP_TCP_WINDOW
+	if(uip_connr->rtxq != NULL) {
+	  /* The FIN is sent when the queued data has been
+	     acknowledged. */
+	  uip_connr->wflags |= UIP_TCPW_CLOSEPENDING;
+	  goto appsend_window;
+	}
+#endif /* UIP_TCP_WINDOW */
 	uip_connr->len = 1;
 	uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
 	uip_connr->nrtx = 0;
@@ -1727,6 +1799,35 @@ uip_process(uint8_t flag)
 	goto tcp_send_nodata;
       }
 
+#if UIP_TCP_WINDOW
+      /* If uip_slen > 0, the application has data to be sent. It is
+	 sent if it fits in the retransmission queue. */
+      if(uip_slen > 0) {
+	if(uip_slen > uip_connr->mss) {
+	  uip_slen = uip_connr->mss;
+	}
+	if(!uip_tcp_window_push(uip_connr, uip_sappdata, uip_slen)) {
+	  uip_slen = 0;
+	}
+      }
+    appsend_window:
+      uip_appdata = uip_sappdata;
+      if(uip_connr->wflags & UIP_TCPW_REXMIT) {
+	goto tcp_send_rexmit;
+      }
+      if(uip_slen > 0) {
+	/* The new segment follows the segments already in flight. */
+	tcp_seqoff = uip_connr->len - uip_slen;
+	uip_len = uip_slen + UIP_TCPIP_HLEN;
+	BUF->flags = TCP_ACK | TCP_PSH;
+	goto tcp_send_noopts;
+      }
+      if(uip_flags & UIP_NEWDATA) {
+	uip_len = UIP_TCPIP_HLEN;
+	BUF->flags = TCP_ACK;
+	goto tcp_send_noopts;
+      }
+#else /* UIP_TCP_WINDOW */
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
 
@@ -1780,7 +1881,14 @@ uip_process(uint8_t flag)
 	BUF->flags = TCP_ACK;
 	goto tcp_send_noopts;
       }
+#endif /* UIP_TCP_WINDOW */
     }
+#if UIP_TCP_WINDOW
+    /* A partial ACK during recovery or a third duplicate ACK. */
+    if(uip_connr->wflags & UIP_TCPW_REXMIT) {
+      goto tcp_send_rexmit;
+    }
+#endif /* UIP_TCP_WINDOW */
     goto drop;
   case UIP_LAST_ACK:
     /* We can close this connection if the peer has acknowledged our
@@ -1849,6 +1957,18 @@ uip_process(uint8_t flag)
   }
   goto drop;
 
+#if UIP_TCP_WINDOW
+  /* Retransmit the oldest unacknowledged segment from the
+     retransmission queue. */
+ tcp_send_rexmit:
+  uip_len = uip_tcp_window_rexmit(uip_connr,
+				  &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN]) +
+    UIP_TCPIP_HLEN;
+  tcp_seqoff = 0;
+  BUF->flags = TCP_ACK | TCP_PSH;
+  goto tcp_send_noopts;
+#endif /* UIP_TCP_WINDOW */
+
   /* We jump here when we are ready to send the packet, and just want
      to set the appropriate TCP sequence numbers in the TCP header. */
  tcp_send_ack:
@@ -1870,10 +1990,24 @@ uip_process(uint8_t flag)
   BUF->ackno[2] = uip_connr->rcv_nxt[2];
   BUF->ackno[3] = uip_connr->rcv_nxt[3];
 
+#if UIP_TCP_WINDOW
+  /* Segments other than data segments carry the sequence number that
+     follows the data in flight. */
+  if(tcp_seqoff == TCP_SEQOFF_DEFAULT) {
+    tcp_seqoff = uip_connr->rtxq != NULL ? uip_connr->len : 0;
+  }
+  uip_add32(uip_connr->snd_nxt, tcp_seqoff);
+  tcp_seqoff = TCP_SEQOFF_DEFAULT;
+  BUF->seqno[0] = uip_acc32[0];
+  BUF->seqno[1] = uip_acc32[1];
+  BUF->seqno[2] = uip_acc32[2];
+  BUF->seqno[3] = uip_acc32[3];
+#else /* UIP_TCP_WINDOW */
   BUF->seqno[0] = uip_connr->snd_nxt[0];
   BUF->seqno[1] = uip_connr->snd_nxt[1];
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
+#endif /* UIP_TCP_WINDOW */
 
   BUF->proto = UIP_PROTO_TCP;
 
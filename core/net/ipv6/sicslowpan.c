@@ -221,35 +221,71 @@ static int last_tx_status;
  *  @{
  */
 
+/** The total length of the IPv6 packet in the sicslowpan_buf. */
 static uint16_t sicslowpan_len;
 
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * The buffer the received IPv6 packet is uncompressed into: the buffer
+ * of a reassembly context for fragments, uip_buf otherwise.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
-
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+static uint8_t *sicslowpan_buf;
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * A 6lowpan reassembly context. The fragments of a packet are
+ * identified by the link-layer sender, the datagram tag and the
+ * datagram size.
  */
-static uint16_t processed_ip_in_len;
+struct reass_context {
+  /**
+   * The buffer used for the 6lowpan reassembly.
+   * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
+   * It has a fix size as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+  linkaddr_t sender;
+  uint16_t tag;
+  /** Size of the packet being reassembled, 0 if the context is free. */
+  uint16_t size;
+  /**
+   * length of the ip packet already received.
+   * It includes IP and transport headers.
+   */
+  uint16_t received;
+  /** The 8-byte units of the packet already received. */
+  uint8_t received_map[(UIP_BUFSIZE / 8 + 7) / 8];
+  /** Reassembly %process %timer. */
+  struct timer timer;
+};
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
+static struct reass_context reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+#define FRAG_FORWARDING (SICSLOWPAN_FRAG_FORWARDING > 0 && UIP_CONF_ROUTER)
 
-/** When reassembling, the source address of the fragments being merged */
-linkaddr_t frag_sender;
+#if FRAG_FORWARDING
+/**
+ * A packet that is forwarded fragment by fragment. The incoming
+ * fragments are identified as for reassembly, and are relayed to the
+ * next hop with a tag of our own.
+ */
+struct frag_fwd {
+  linkaddr_t sender;
+  uint16_t tag;
+  /** Size of the packet, 0 if the entry is free. */
+  uint16_t size;
+  linkaddr_t next_hop;
+  uint16_t next_tag;
+  /** Number of bytes of the packet forwarded so far. */
+  uint16_t forwarded;
+  /** The 8-byte units of the packet already forwarded. */
+  uint8_t received_map[(UIP_BUFSIZE / 8 + 7) / 8];
+  struct timer timer;
+};
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+static struct frag_fwd frag_fwds[SICSLOWPAN_FRAG_FORWARDING];
+#endif /* FRAG_FORWARDING */
+
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -259,6 +295,10 @@ static struct timer reass_timer;
 #define sicslowpan_len uip_len
 #endif /* SICSLOWPAN_CONF_FRAG */
 
+#if SICSLOWPAN_CONF_STATS
+struct sicslowpan_stats sicslowpan_stats;
+#endif /* SICSLOWPAN_CONF_STATS */
+
 static int last_rssi;
 
 /*-------------------------------------------------------------------------*/
@@ -1371,13 +1411,18 @@ output(const uip_lladdr_t *localdest)
   /* Number of bytes processed. */
   uint16_t processed_ip_out_len;
 
+  /* Priority class set by the IP layer */
+  uint8_t priority;
+
   /* init */
   uncomp_hdr_len = 0;
   packetbuf_hdr_len = 0;
 
   /* reset packetbuf buffer */
+  priority = packetbuf_attr(PACKETBUF_ATTR_PRIORITY);
   packetbuf_clear();
   packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY, priority);
 
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
@@ -1569,6 +1614,315 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that have timed out */
+static void
+reass_expire(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass_contexts[i].size > 0 && timer_expired(&reass_contexts[i].timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n",
+              reass_contexts[i].tag);
+      reass_contexts[i].size = 0;
+      SICSLOWPAN_STAT(sicslowpan_stats.reass_timeouts++);
+    }
+  }
+#if FRAG_FORWARDING
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARDING; i++) {
+    if(frag_fwds[i].size > 0 && timer_expired(&frag_fwds[i].timer)) {
+      frag_fwds[i].size = 0;
+    }
+  }
+#endif /* FRAG_FORWARDING */
+}
+/*--------------------------------------------------------------------*/
+/** \brief Find the reassembly context of a fragment */
+static struct reass_context *
+reass_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass_contexts[i].size == size &&
+       reass_contexts[i].tag == tag &&
+       linkaddr_cmp(&reass_contexts[i].sender, sender)) {
+      return &reass_contexts[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Start reassembling a packet
+ *
+ * If all contexts are in use, the oldest reassembly is discarded. This
+ * lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
+ */
+static struct reass_context *
+reass_start(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct reass_context *context;
+  int i;
+
+  context = NULL;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass_contexts[i].size == 0) {
+      context = &reass_contexts[i];
+      break;
+    }
+    if(context == NULL ||
+       timer_remaining(&reass_contexts[i].timer) <
+       timer_remaining(&context->timer)) {
+      context = &reass_contexts[i];
+    }
+  }
+
+  if(context->size > 0) {
+    PRINTFI("sicslowpan input: discarding reassembly (tag %d)\n",
+            context->tag);
+    SICSLOWPAN_STAT(sicslowpan_stats.reass_discarded++);
+  }
+
+  linkaddr_copy(&context->sender, sender);
+  context->tag = tag;
+  context->size = size;
+  context->received = 0;
+  memset(context->received_map, 0, sizeof(context->received_map));
+  timer_set(&context->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  SICSLOWPAN_STAT(sicslowpan_stats.reass_started++);
+  return context;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Mark the bytes [start, end) of a packet in a map of 8-byte units
+ * \return 1 if none of them had been marked before, 0 otherwise
+ */
+static int
+frag_mark(uint8_t *map, uint16_t start, uint16_t end)
+{
+  uint16_t unit;
+
+  if(end <= start) {
+    return 0;
+  }
+  for(unit = start >> 3; unit <= (end - 1) >> 3; unit++) {
+    if(map[unit >> 3] & (1 << (unit & 7))) {
+      return 0;
+    }
+  }
+  for(unit = start >> 3; unit <= (end - 1) >> 3; unit++) {
+    map[unit >> 3] |= 1 << (unit & 7);
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Mark the bytes [start, end) of a packet as received
+ * \return 1 if none of them had been received before, 0 otherwise
+ */
+static int
+reass_mark(struct reass_context *context, uint16_t start, uint16_t end)
+{
+  if(!frag_mark(context->received_map, start, end)) {
+    return 0;
+  }
+  context->received += end - start;
+  return 1;
+}
+#if FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \brief Find the forwarding entry of a fragment */
+static struct frag_fwd *
+fwd_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARDING; i++) {
+    if(frag_fwds[i].size == size &&
+       frag_fwds[i].tag == tag &&
+       linkaddr_cmp(&frag_fwds[i].sender, sender)) {
+      return &frag_fwds[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Get the link-layer address of the next hop towards an address */
+static const uip_lladdr_t *
+fwd_next_hop(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *route;
+  uip_ipaddr_t *nexthop;
+
+  if(uip_ds6_is_addr_onlink(addr)) {
+    nexthop = addr;
+  } else {
+    route = uip_ds6_route_lookup(addr);
+    if(route != NULL) {
+      nexthop = uip_ds6_route_nexthop(route);
+    } else {
+      nexthop = uip_ds6_defrt_choose();
+    }
+  }
+  if(nexthop == NULL) {
+    return NULL;
+  }
+  return uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a packet, held uncompressed in
+ * uip_buf, if the packet is not for us
+ * \param tag The datagram tag of the incoming fragment
+ * \param size The size of the packet
+ * \param len The number of bytes of the packet in the fragment
+ * \return 1 if the fragment was forwarded, 0 if the packet has to be
+ * reassembled
+ *
+ * Only the IP header is looked at: the hop limit is decremented, and the
+ * header is compressed again for the next hop. The following fragments
+ * are relayed as they are received. Packets with extension headers,
+ * which the IP layer may have to process (e.g., the RPL hop-by-hop
+ * option), and packets that need an ICMP error are left to the IP layer.
+ */
+static int
+fwd_first_fragment(uint16_t tag, uint16_t size, uint16_t len)
+{
+  struct frag_fwd *fwd;
+  const uip_lladdr_t *next_hop;
+  linkaddr_t dest;
+  uint8_t saved_uncomp_hdr_len;
+  int framer_hdrlen;
+  int i;
+
+  if(uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_aaddr(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->destipaddr) ||
+     (UIP_IP_BUF->proto != UIP_PROTO_TCP &&
+      UIP_IP_BUF->proto != UIP_PROTO_UDP &&
+      UIP_IP_BUF->proto != UIP_PROTO_ICMP6) ||
+     UIP_IP_BUF->ttl <= 1) {
+    return 0;
+  }
+
+  fwd = NULL;
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARDING; i++) {
+    if(frag_fwds[i].size == 0) {
+      fwd = &frag_fwds[i];
+      break;
+    }
+  }
+  next_hop = fwd_next_hop(&UIP_IP_BUF->destipaddr);
+  if(fwd == NULL || next_hop == NULL) {
+    return 0;
+  }
+  linkaddr_copy(&dest, (const linkaddr_t *)next_hop);
+  linkaddr_copy(&fwd->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+
+  UIP_IP_BUF->ttl--;
+
+  saved_uncomp_hdr_len = uncomp_hdr_len;
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
+  compress_hdr_hc1(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+  compress_hdr_ipv6(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+  compress_hdr_hc06(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, my_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+
+  /* The headers may not compress as well for the next hop as they
+     did for us. */
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = 21;
+  }
+  if(packetbuf_hdr_len + len - uncomp_hdr_len >
+     MAC_MAX_PAYLOAD - framer_hdrlen - NETSTACK_LLSEC.get_overhead()) {
+    PRINTFI("sicslowpan input: first fragment too large to forward\n");
+    UIP_IP_BUF->ttl++;
+    uncomp_hdr_len = saved_uncomp_hdr_len;
+    return 0;
+  }
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, len - uncomp_hdr_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + len - uncomp_hdr_len);
+
+  fwd->tag = tag;
+  fwd->size = size;
+  linkaddr_copy(&fwd->next_hop, &dest);
+  fwd->next_tag = my_tag;
+  fwd->forwarded = len;
+  memset(fwd->received_map, 0, sizeof(fwd->received_map));
+  frag_mark(fwd->received_map, 0, len);
+  timer_set(&fwd->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  my_tag++;
+
+  PRINTFI("sicslowpan input: forwarding fragments (tag %d as %d)\n",
+          tag, fwd->next_tag);
+  SICSLOWPAN_STAT(sicslowpan_stats.frags_forwarded++);
+  send_packet(&dest);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Relay a subsequent fragment of a forwarded packet
+ * \param offset The offset of the fragment in 8-byte units
+ *
+ * Duplicates of fragments that have already been relayed are dropped.
+ */
+static void
+fwd_fragment(struct frag_fwd *fwd, uint8_t offset)
+{
+  uint8_t *frame;
+  uint16_t len;
+
+  frame = packetbuf_dataptr();
+  len = packetbuf_datalen();
+  if(len <= SICSLOWPAN_FRAGN_HDR_LEN ||
+     (offset << 3) + len - SICSLOWPAN_FRAGN_HDR_LEN > fwd->size ||
+     !frag_mark(fwd->received_map, offset << 3,
+                (offset << 3) + len - SICSLOWPAN_FRAGN_HDR_LEN)) {
+    PRINTFI("sicslowpan input: dropping duplicate or invalid fragment\n");
+    SICSLOWPAN_STAT(sicslowpan_stats.frags_dropped++);
+    return;
+  }
+  SET16(frame, PACKETBUF_FRAG_TAG, fwd->next_tag);
+
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), frame, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+  fwd->forwarded += len - SICSLOWPAN_FRAGN_HDR_LEN;
+  if(fwd->forwarded >= fwd->size) {
+    fwd->size = 0;
+  }
+  SICSLOWPAN_STAT(sicslowpan_stats.frags_forwarded++);
+  send_packet(&fwd->next_hop);
+}
+#endif /* FRAG_FORWARDING */
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1576,11 +1930,13 @@ output(const uip_lladdr_t *localdest)
  *  The 6lowpan packet is put in packetbuf by the MAC. If its a frag1 or
  *  a non-fragmented packet we first uncompress the IP header. The
  *  6lowpan payload and possibly the uncompressed IP header are then
- *  copied in siclowpan_buf. If the IP packet is complete it is copied
+ *  copied in the reassembly buffer of the packet, or in uip_buf if the
+ *  packet is not fragmented. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
- * \note We do not check for overlapping sicslowpan fragments
- * (it is a SHALL in the RFC 4944 and should never happen)
+ * \note Fragments overlapping data already received are dropped, which
+ * takes care of duplicates. We do not discard the whole packet on
+ * overlap (it is a SHALL in the RFC 4944 and should never happen)
  */
 static void
 input(void)
@@ -1593,7 +1949,13 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
+  uint8_t first_fragment = 0;
+  struct reass_context *context = NULL;
+  uint16_t frag_start, frag_end;
+#if FRAG_FORWARDING
+  struct frag_fwd *fwd;
+  linkaddr_t frag_sender;
+#endif /* FRAG_FORWARDING */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1608,10 +1970,7 @@ input(void)
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
   /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  reass_expire();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1643,77 +2002,60 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-
-  if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+  if(is_fragment) {
+    if(frag_size == 0 || frag_size > UIP_BUFSIZE - UIP_LLH_LEN) {
+      PRINTFI("sicslowpan input: Dropping fragment of invalid size %d\n",
+              frag_size);
+      SICSLOWPAN_STAT(sicslowpan_stats.frags_dropped++);
       return;
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
+    context = reass_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                           frag_tag, frag_size);
+#if FRAG_FORWARDING
+    if(context == NULL) {
+      fwd = fwd_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                       frag_tag, frag_size);
+      if(fwd != NULL) {
+        /* A copy of the first fragment has already been forwarded. */
+        if(!first_fragment) {
+          fwd_fragment(fwd, frag_offset);
+        }
         return;
       }
-
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
+    }
+#endif /* FRAG_FORWARDING */
+    if(context != NULL) {
+      sicslowpan_buf = context->buf.u8;
+    } else if(!first_fragment) {
+      /* We are currently not reassembling this packet, but have
+       * received a packet fragment that is not the first one. */
+      PRINTFI("sicslowpan input: Dropping 6lowpan fragment of a packet that is not being reassembled\n");
+      SICSLOWPAN_STAT(sicslowpan_stats.frags_dropped++);
+      return;
+    } else {
+#if FRAG_FORWARDING
+      /* The first fragment is uncompressed into uip_buf. It is moved
+       * to a reassembly context only if it cannot be forwarded. */
       linkaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      sicslowpan_buf = uip_buf;
+#else /* FRAG_FORWARDING */
+      context = reass_start(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                            frag_tag, frag_size);
+      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+              frag_size, frag_tag);
+      sicslowpan_buf = context->buf.u8;
+#endif /* FRAG_FORWARDING */
     }
+  } else {
+    /* Packets that are not fragmented are uncompressed directly into
+     * uip_buf, leaving ongoing reassemblies alone. */
+    sicslowpan_buf = uip_buf;
   }
 
   if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1775,77 +2117,90 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          packetbuf_payload_len, req_size, sizeof(sicslowpan_buf));
+          packetbuf_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
 
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
   
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
+  /* update the received part of the packet if fragment, sicslowpan_len
+     otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
+  if(is_fragment) {
+    /* The first fragment also carries the uncompressed headers. For
+       the last fragment, we are OK if there is extrenous bytes at the
+       end of the packet. We must be liberal in what we accept. */
+    frag_start = first_fragment ? 0 : (uint16_t)(frag_offset << 3);
+    frag_end = uncomp_hdr_len + (uint16_t)(frag_offset << 3) + packetbuf_payload_len;
+    if(frag_end > frag_size) {
+      frag_end = frag_size;
     }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
-    } else {
-      processed_ip_in_len += packetbuf_payload_len;
+#if FRAG_FORWARDING
+    if(context == NULL) {
+      if(fwd_first_fragment(frag_tag, frag_size, frag_end)) {
+        return;
+      }
+      context = reass_start(&frag_sender, frag_tag, frag_size);
+      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+              frag_size, frag_tag);
+      memcpy(context->buf.u8, uip_buf, UIP_LLH_LEN + frag_end);
+      sicslowpan_buf = context->buf.u8;
+    }
+#endif /* FRAG_FORWARDING */
+    if(!reass_mark(context, frag_start, frag_end)) {
+      PRINTFI("sicslowpan input: Dropping duplicate 6lowpan fragment\n");
+      SICSLOWPAN_STAT(sicslowpan_stats.frags_dropped++);
+      return;
+    }
+    PRINTF("received %d of %d, packetbuf_payload_len %d\n",
+           context->received, context->size, packetbuf_payload_len);
+    if(context->received < context->size) {
+      return;
     }
-    PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", processed_ip_in_len, packetbuf_payload_len);
 
+    /*
+     * We have a full IP packet in the reassembly buffer, deliver it to
+     * the IP stack
+     */
+    sicslowpan_len = context->size;
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
+    context->size = 0;
+    SICSLOWPAN_STAT(sicslowpan_stats.reass_completed++);
   } else {
-#endif /* SICSLOWPAN_CONF_FRAG */
     sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
   }
-
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
+  PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
+          sicslowpan_len);
+  uip_len = sicslowpan_len;
+#else /* SICSLOWPAN_CONF_FRAG */
+  sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
-    {
-      uint16_t ndx;
-      PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
-      for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
-        uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
-        PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint16_t ndx;
+    PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
+    for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
-    /* if callback is set then set attributes and call */
-    if(callback) {
-      set_packet_attrs();
-      callback->input_callback();
-    }
-
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+  /* if callback is set then set attributes and call */
+  if(callback) {
+    set_packet_attrs();
+    callback->input_callback();
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+
+  tcpip_input();
 }
 /** @} */
 
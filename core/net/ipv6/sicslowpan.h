@@ -318,6 +318,26 @@ struct sicslowpan_nh_compressor {
 
 };
 
+#if SICSLOWPAN_CONF_STATS
+/** Statistics for 6lowpan fragment reassembly. */
+struct sicslowpan_stats {
+  uint16_t reass_started;   /**< Number of reassemblies started. */
+  uint16_t reass_completed; /**< Number of packets reassembled. */
+  uint16_t reass_timeouts;  /**< Number of reassemblies timed out. */
+  uint16_t reass_discarded; /**< Number of reassemblies discarded to
+                                 make room for a new one. */
+  uint16_t frags_dropped;   /**< Number of fragments dropped: duplicate,
+                                 invalid, or of an unknown packet. */
+  uint16_t frags_forwarded; /**< Number of fragments forwarded without
+                                 reassembly. */
+};
+
+extern struct sicslowpan_stats sicslowpan_stats;
+#define SICSLOWPAN_STAT(code) (code)
+#else /* SICSLOWPAN_CONF_STATS */
+#define SICSLOWPAN_STAT(code)
+#endif /* SICSLOWPAN_CONF_STATS */
+
 int sicslowpan_get_last_rssi(void);
 
 extern const struct network_driver sicslowpan_driver;
@@ -70,10 +70,59 @@ void LINK_NEIGHBOR_CALLBACK(const linkaddr_t *addr, int status, int numtx);
 
 NBR_TABLE_GLOBAL(uip_ds6_nbr_t, ds6_neighbors);
 
+#if UIP_DS6_NBR_HASH
+/* Neighbors are chained by IPv6 address through the hash_next
+   field. Entries leave the table through uip_ds6_nbr_rm(), which is
+   also the nbr-table callback, so the index follows evictions. */
+static uip_ds6_nbr_t *nbr_hash[UIP_DS6_NBR_HASH_SIZE];
+#endif /* UIP_DS6_NBR_HASH */
+
+/*---------------------------------------------------------------------------*/
+#if UIP_DS6_NBR_HASH
+static uip_ds6_nbr_t **
+hash_bucket(const uip_ipaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  /* The interface identifier is what differs between neighbors. */
+  h = 0;
+  for(i = 8; i < sizeof(uip_ipaddr_t); i++) {
+    h = (h << 5) - h + addr->u8[i];
+  }
+  return &nbr_hash[h % UIP_DS6_NBR_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **pp;
+
+  pp = hash_bucket(&nbr->ipaddr);
+  nbr->hash_next = *pp;
+  *pp = nbr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **pp;
+
+  for(pp = hash_bucket(&nbr->ipaddr); *pp != NULL; pp = &(*pp)->hash_next) {
+    if(*pp == nbr) {
+      *pp = nbr->hash_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_DS6_NBR_HASH */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_neighbors_init(void)
 {
+#if UIP_DS6_NBR_HASH
+  memset(nbr_hash, 0, sizeof(nbr_hash));
+#endif /* UIP_DS6_NBR_HASH */
   nbr_table_register(ds6_neighbors, (nbr_table_callback *)uip_ds6_nbr_rm);
 }
 /*---------------------------------------------------------------------------*/
@@ -81,9 +130,25 @@ uip_ds6_nbr_t *
 uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
                 uint8_t isrouter, uint8_t state)
 {
-  uip_ds6_nbr_t *nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr);
+  uip_ds6_nbr_t *nbr;
+
+#if UIP_DS6_NBR_HASH
+  /* nbr_table_add_lladdr() reuses and clears an existing entry for
+     the same link-layer address, so take that entry out of the index
+     first. */
+  nbr = nbr_table_get_from_lladdr(ds6_neighbors, lladdr != NULL ?
+                                  (linkaddr_t*)lladdr : &linkaddr_null);
+  if(nbr != NULL) {
+    hash_remove(nbr);
+  }
+#endif /* UIP_DS6_NBR_HASH */
+
+  nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr);
   if(nbr) {
     uip_ipaddr_copy(&nbr->ipaddr, ipaddr);
+#if UIP_DS6_NBR_HASH
+    hash_add(nbr);
+#endif /* UIP_DS6_NBR_HASH */
     nbr->isrouter = isrouter;
     nbr->state = state;
   #if UIP_CONF_IPV6_QUEUE_PKT
@@ -119,6 +184,9 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
     uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
     NEIGHBOR_STATE_CHANGED(nbr);
+#if UIP_DS6_NBR_HASH
+    hash_remove(nbr);
+#endif /* UIP_DS6_NBR_HASH */
     nbr_table_remove(ds6_neighbors, nbr);
   }
   return;
@@ -156,6 +224,16 @@ uip_ds6_nbr_num(void)
 uip_ds6_nbr_t *
 uip_ds6_nbr_lookup(const uip_ipaddr_t *ipaddr)
 {
+#if UIP_DS6_NBR_HASH
+  uip_ds6_nbr_t *nbr;
+  if(ipaddr != NULL) {
+    for(nbr = *hash_bucket(ipaddr); nbr != NULL; nbr = nbr->hash_next) {
+      if(uip_ipaddr_cmp(&nbr->ipaddr, ipaddr)) {
+        return nbr;
+      }
+    }
+  }
+#else /* UIP_DS6_NBR_HASH */
   uip_ds6_nbr_t *nbr = nbr_table_head(ds6_neighbors);
   if(ipaddr != NULL) {
     while(nbr != NULL) {
@@ -165,6 +243,7 @@ uip_ds6_nbr_lookup(const uip_ipaddr_t *ipaddr)
       nbr = nbr_table_next(ds6_neighbors, nbr);
     }
   }
+#endif /* UIP_DS6_NBR_HASH */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -64,6 +64,22 @@
 #define  NBR_DELAY 3
 #define  NBR_PROBE 4
 
+/* Index the neighbor cache by IPv6 address in a hash table, so that
+   uip_ds6_nbr_lookup() does not have to scan the whole table. Useful
+   for routers with many neighbors, where every forwarded packet
+   looks up its next hop. */
+#ifdef UIP_DS6_NBR_CONF_HASH
+#define UIP_DS6_NBR_HASH UIP_DS6_NBR_CONF_HASH
+#else /* UIP_DS6_NBR_CONF_HASH */
+#define UIP_DS6_NBR_HASH 0
+#endif /* UIP_DS6_NBR_CONF_HASH */
+
+#ifdef UIP_DS6_NBR_CONF_HASH_SIZE
+#define UIP_DS6_NBR_HASH_SIZE UIP_DS6_NBR_CONF_HASH_SIZE
+#else /* UIP_DS6_NBR_CONF_HASH_SIZE */
+#define UIP_DS6_NBR_HASH_SIZE NBR_TABLE_MAX_NEIGHBORS
+#endif /* UIP_DS6_NBR_CONF_HASH_SIZE */
+
 NBR_TABLE_DECLARE(ds6_neighbors);
 
 /** \brief An entry in the nbr cache */
@@ -78,6 +94,9 @@ typedef struct uip_ds6_nbr {
   struct uip_packetqueue_handle packethandle;
 #define UIP_DS6_NBR_PACKET_LIFETIME CLOCK_SECOND * 4
 #endif                          /*UIP_CONF_QUEUE_PKT */
+#if UIP_DS6_NBR_HASH
+  struct uip_ds6_nbr *hash_next;
+#endif /* UIP_DS6_NBR_HASH */
 } uip_ds6_nbr_t;
 
 void uip_ds6_neighbors_init(void);
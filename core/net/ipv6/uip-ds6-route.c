@@ -51,7 +51,19 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 /* Each route is repressented by a uip_ds6_route_t structure and
    memory for each route is allocated from the routememb memory
    block. These routes are maintained on the routelist. */
+#if UIP_DS6_ROUTE_HASH
+/* The routelist is doubly linked through the pprev field so that
+   routes can be moved to the end of the list in constant time. */
+static uip_ds6_route_t *routelist;
+static uip_ds6_route_t **routelist_tail;
+
+/* Host routes are hashed by address. Routes to shorter prefixes are
+   held on the prefixlist, longest prefix first. */
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH_SIZE];
+static uip_ds6_route_t *prefixlist;
+#else /* UIP_DS6_ROUTE_HASH */
 LIST(routelist);
+#endif /* UIP_DS6_ROUTE_HASH */
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 /* Default routes are held on the defaultrouterlist and their
@@ -65,6 +77,10 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_CONF_STATS
+struct uip_ds6_route_stats uip_ds6_route_stats;
+#endif /* UIP_DS6_ROUTE_CONF_STATS */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -99,6 +115,108 @@ assert_nbr_routes_list_sane(void)
 }
 #endif /* DEBUG != DEBUG_NONE */
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+static uip_ds6_route_t **
+hash_bucket(const uip_ipaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(uip_ipaddr_t); i++) {
+    h = (h << 5) - h + addr->u8[i];
+  }
+  return &route_hash[h % UIP_DS6_ROUTE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+/* Add a route to the hash table or the prefix list. Must be called
+   after the address and prefix length of the route have been set. */
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **pp;
+
+  if(r->length >= 128) {
+    pp = hash_bucket(&r->ipaddr);
+  } else {
+    for(pp = &prefixlist;
+        *pp != NULL && (*pp)->length > r->length;
+        pp = &(*pp)->hash_next);
+  }
+  r->hash_next = *pp;
+  *pp = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **pp;
+
+  if(r->length >= 128) {
+    pp = hash_bucket(&r->ipaddr);
+  } else {
+    pp = &prefixlist;
+  }
+  for(; *pp != NULL; pp = &(*pp)->hash_next) {
+    if(*pp == r) {
+      *pp = r->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+
+  /* A host route is always the longest match. */
+  for(r = *hash_bucket(addr); r != NULL; r = r->hash_next) {
+    UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.compares++);
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      return r;
+    }
+  }
+
+  /* The prefix list is sorted with the longest prefix first. */
+  for(r = prefixlist; r != NULL; r = r->hash_next) {
+    UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.compares++);
+    if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
+static void
+routelist_add(uip_ds6_route_t *r)
+{
+#if UIP_DS6_ROUTE_HASH
+  r->next = NULL;
+  r->pprev = routelist_tail;
+  *routelist_tail = r;
+  routelist_tail = &r->next;
+#else /* UIP_DS6_ROUTE_HASH */
+  list_add(routelist, r);
+#endif /* UIP_DS6_ROUTE_HASH */
+}
+/*---------------------------------------------------------------------------*/
+static void
+routelist_remove(uip_ds6_route_t *r)
+{
+#if UIP_DS6_ROUTE_HASH
+  *r->pprev = r->next;
+  if(r->next != NULL) {
+    r->next->pprev = r->pprev;
+  } else {
+    routelist_tail = r->pprev;
+  }
+#else /* UIP_DS6_ROUTE_HASH */
+  list_remove(routelist, r);
+#endif /* UIP_DS6_ROUTE_HASH */
+}
+/*---------------------------------------------------------------------------*/
 #if UIP_DS6_NOTIFICATIONS
 static void
 call_route_callback(int event, uip_ipaddr_t *route,
@@ -140,7 +258,14 @@ void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
+#if UIP_DS6_ROUTE_HASH
+  routelist = NULL;
+  routelist_tail = &routelist;
+  memset(route_hash, 0, sizeof(route_hash));
+  prefixlist = NULL;
+#else /* UIP_DS6_ROUTE_HASH */
   list_init(routelist);
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -176,7 +301,11 @@ uip_ds6_route_nexthop(uip_ds6_route_t *route)
 uip_ds6_route_t *
 uip_ds6_route_head(void)
 {
+#if UIP_DS6_ROUTE_HASH
+  return routelist;
+#else /* UIP_DS6_ROUTE_HASH */
   return list_head(routelist);
+#endif /* UIP_DS6_ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
@@ -198,26 +327,34 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
+  UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.lookups++);
 
+#if UIP_DS6_ROUTE_HASH
+  found_route = index_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
+    UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.compares++);
     if(r->length >= longestmatch &&
        uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
       longestmatch = r->length;
       found_route = r;
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -225,8 +362,10 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF(" via ");
     PRINT6ADDR(uip_ds6_route_nexthop(found_route));
     PRINTF("\n");
+    UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.hits++);
   } else {
     PRINTF("uip-ds6-route: No route found\n");
+    UIP_DS6_ROUTE_STAT(uip_ds6_route_stats.misses++);
   }
 
   if(found_route != NULL) {
@@ -234,8 +373,8 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the start of the
        list. */
-    list_remove(routelist, found_route);
-    list_add(routelist, found_route);
+    routelist_remove(found_route);
+    routelist_add(found_route);
   }
 
   return found_route;
@@ -328,13 +467,14 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
       return NULL;
     }
 
-    list_add(routelist, r);
+    routelist_add(r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       PRINTF("uip_ds6_route_add: could not allocate neighbor route list entry\n");
+      routelist_remove(r);
       memb_free(&routememb, r);
       return NULL;
     }
@@ -350,6 +490,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -387,7 +530,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     /* Remove the neighbor from the route list */
-    list_remove(routelist, route);
+    routelist_remove(route);
+#if UIP_DS6_ROUTE_HASH
+    index_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -80,6 +80,38 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Index host (/128) routes in a hash table and keep shorter prefixes
+   on a separate list sorted by prefix length, so that route lookups
+   do not have to scan the whole routing table. Also makes the LRU
+   bookkeeping on lookup constant time. Useful for RPL storing mode
+   roots with many downward routes. */
+#ifdef UIP_DS6_ROUTE_CONF_HASH
+#define UIP_DS6_ROUTE_HASH UIP_DS6_ROUTE_CONF_HASH
+#else /* UIP_DS6_ROUTE_CONF_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_DS6_ROUTE_CONF_HASH */
+
+#ifdef UIP_DS6_ROUTE_CONF_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_CONF_HASH_SIZE
+#else /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_NB
+#endif /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+
+#if UIP_DS6_ROUTE_CONF_STATS
+/* Route lookup statistics. */
+struct uip_ds6_route_stats {
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t compares;
+};
+
+extern struct uip_ds6_route_stats uip_ds6_route_stats;
+#define UIP_DS6_ROUTE_STAT(code) (code)
+#else /* UIP_DS6_ROUTE_CONF_STATS */
+#define UIP_DS6_ROUTE_STAT(code)
+#endif /* UIP_DS6_ROUTE_CONF_STATS */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -102,6 +134,12 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+#if UIP_DS6_ROUTE_HASH
+  /* Back pointer for the LRU ordered route list, and link to the
+     next route in the same hash bucket or on the prefix list. */
+  struct uip_ds6_route **pprev;
+  struct uip_ds6_route *hash_next;
+#endif /* UIP_DS6_ROUTE_HASH */
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
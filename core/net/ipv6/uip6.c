@@ -72,6 +72,8 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-tcp-window.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
@@ -182,6 +184,13 @@ uint16_t uip_urglen, uip_surglen;
 
 /* The uip_len is either 8 or 16 bits, depending on the maximum packet size.*/
 uint16_t uip_len, uip_slen;
+
+#if UIP_TCP_WINDOW
+/* The offset from snd_nxt of the sequence number of the next segment
+   that is sent. TCP_SEQOFF_DEFAULT means after all data in flight. */
+#define TCP_SEQOFF_DEFAULT 0xffff
+static uint16_t tcp_seqoff = TCP_SEQOFF_DEFAULT;
+#endif /* UIP_TCP_WINDOW */
 /** @} */
 
 /*---------------------------------------------------------------------------*/
@@ -300,41 +309,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-  
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-  
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -343,7 +321,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -373,10 +351,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
                upper_layer_len);
     
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -406,6 +384,215 @@ uip_udpchksum(void)
 #endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+/* Connection lookup                                                         */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_HASH
+/* The connections in a hash bucket are kept in the same order as in
+   the connection arrays, so that a lookup finds the connection that a
+   search through the array would find. Closed TCP connections are
+   removed from their buckets when a lookup passes them or when the
+   connection is reused. */
+#define PORT_HASH(port) (uip_ntohs(port) % UIP_CONN_HASH_SIZE)
+#define TCP_HASH(lport, rport, addr)                                    \
+  (((uint16_t)(uip_ntohs(lport) + uip_ntohs(rport)) ^                  \
+    uip_ntohs((addr)->u16[7])) % UIP_CONN_HASH_SIZE)
+
+#if UIP_TCP
+static struct uip_conn *tcp_buckets[UIP_CONN_HASH_SIZE];
+static struct uip_conn *tcp_port_buckets[UIP_CONN_HASH_SIZE];
+#endif /* UIP_TCP */
+#if UIP_UDP
+static struct uip_udp_conn *udp_buckets[UIP_CONN_HASH_SIZE];
+#endif /* UIP_UDP */
+#endif /* UIP_CONN_HASH */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+#if UIP_CONN_HASH
+static void
+tcp_hash(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+
+  for(p = &tcp_buckets[TCP_HASH(conn->lport, conn->rport, &conn->ripaddr)];
+      *p != NULL && *p < conn; p = &(*p)->hnext);
+  conn->hnext = *p;
+  *p = conn;
+
+  for(p = &tcp_port_buckets[PORT_HASH(conn->lport)];
+      *p != NULL && *p < conn; p = &(*p)->pnext);
+  conn->pnext = *p;
+  *p = conn;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_unhash(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+
+  for(p = &tcp_buckets[TCP_HASH(conn->lport, conn->rport, &conn->ripaddr)];
+      *p != NULL; p = &(*p)->hnext) {
+    if(*p == conn) {
+      *p = conn->hnext;
+      break;
+    }
+  }
+
+  for(p = &tcp_port_buckets[PORT_HASH(conn->lport)];
+      *p != NULL; p = &(*p)->pnext) {
+    if(*p == conn) {
+      *p = conn->pnext;
+      break;
+    }
+  }
+}
+#else /* UIP_CONN_HASH */
+#define tcp_hash(conn)
+#define tcp_unhash(conn)
+#endif /* UIP_CONN_HASH */
+/*---------------------------------------------------------------------------*/
+/* Find the connection that the incoming segment belongs to. */
+static struct uip_conn *
+tcp_lookup(void)
+{
+  struct uip_conn *conn;
+#if UIP_CONN_HASH
+  struct uip_conn **p;
+
+  p = &tcp_buckets[TCP_HASH(UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport,
+                            &UIP_IP_BUF->srcipaddr)];
+  while((conn = *p) != NULL) {
+    if(conn->tcpstateflags == UIP_CLOSED) {
+      *p = conn->hnext;
+      continue;
+    }
+#else /* UIP_CONN_HASH */
+  for(conn = &uip_conns[0]; conn <= &uip_conns[UIP_CONNS - 1]; ++conn) {
+    if(conn->tcpstateflags == UIP_CLOSED) {
+      continue;
+    }
+#endif /* UIP_CONN_HASH */
+    if(UIP_TCP_BUF->destport == conn->lport &&
+       UIP_TCP_BUF->srcport == conn->rport &&
+       uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &conn->ripaddr)) {
+      return conn;
+    }
+#if UIP_CONN_HASH
+    p = &conn->hnext;
+#endif /* UIP_CONN_HASH */
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ACTIVE_OPEN
+/* Check if a connection uses the local port, in network byte order. */
+static int
+tcp_port_in_use(uint16_t port)
+{
+  struct uip_conn *conn;
+#if UIP_CONN_HASH
+  struct uip_conn **p;
+
+  p = &tcp_port_buckets[PORT_HASH(port)];
+  while((conn = *p) != NULL) {
+    if(conn->tcpstateflags == UIP_CLOSED) {
+      *p = conn->pnext;
+    } else if(conn->lport == port) {
+      return 1;
+    } else {
+      p = &conn->pnext;
+    }
+  }
+#else /* UIP_CONN_HASH */
+  for(conn = &uip_conns[0]; conn <= &uip_conns[UIP_CONNS - 1]; ++conn) {
+    if(conn->tcpstateflags != UIP_CLOSED && conn->lport == port) {
+      return 1;
+    }
+  }
+#endif /* UIP_CONN_HASH */
+  return 0;
+}
+#endif /* UIP_ACTIVE_OPEN */
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+#if UIP_CONN_HASH
+void
+uip_udp_set_lport(struct uip_udp_conn *conn, uint16_t lport)
+{
+  struct uip_udp_conn **p;
+
+  if(conn->lport != 0) {
+    for(p = &udp_buckets[PORT_HASH(conn->lport)];
+        *p != NULL; p = &(*p)->hnext) {
+      if(*p == conn) {
+        *p = conn->hnext;
+        break;
+      }
+    }
+  }
+
+  conn->lport = lport;
+  if(lport != 0) {
+    for(p = &udp_buckets[PORT_HASH(lport)];
+        *p != NULL && *p < conn; p = &(*p)->hnext);
+    conn->hnext = *p;
+    *p = conn;
+  }
+}
+#endif /* UIP_CONN_HASH */
+/*---------------------------------------------------------------------------*/
+/* Find the connection that the incoming datagram belongs to. */
+static struct uip_udp_conn *
+udp_lookup(void)
+{
+  struct uip_udp_conn *conn;
+
+#if UIP_CONN_HASH
+  for(conn = udp_buckets[PORT_HASH(UIP_UDP_BUF->destport)];
+      conn != NULL; conn = conn->hnext) {
+#else /* UIP_CONN_HASH */
+  for(conn = &uip_udp_conns[0]; conn < &uip_udp_conns[UIP_UDP_CONNS];
+      ++conn) {
+#endif /* UIP_CONN_HASH */
+    /* If the local UDP port is non-zero, the connection is considered
+       to be used. If so, the local port number is checked against the
+       destination port number in the received packet. If the two port
+       numbers match, the remote port number is checked if the
+       connection is bound to a remote port. Finally, if the
+       connection is bound to a remote IP address, the source IP
+       address of the packet is checked. */
+    if(conn->lport != 0 &&
+       UIP_UDP_BUF->destport == conn->lport &&
+       (conn->rport == 0 ||
+        UIP_UDP_BUF->srcport == conn->rport) &&
+       (uip_is_addr_unspecified(&conn->ripaddr) ||
+        uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &conn->ripaddr))) {
+      return conn;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Check if a connection uses the local port, in network byte order. */
+static int
+udp_port_in_use(uint16_t port)
+{
+  struct uip_udp_conn *conn;
+
+#if UIP_CONN_HASH
+  for(conn = udp_buckets[PORT_HASH(port)]; conn != NULL; conn = conn->hnext) {
+#else /* UIP_CONN_HASH */
+  for(conn = &uip_udp_conns[0]; conn < &uip_udp_conns[UIP_UDP_CONNS];
+      ++conn) {
+#endif /* UIP_CONN_HASH */
+    if(conn->lport == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
 void
 uip_init(void)
 {
@@ -421,6 +608,10 @@ uip_init(void)
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
   }
+#if UIP_CONN_HASH
+  memset(tcp_buckets, 0, sizeof(tcp_buckets));
+  memset(tcp_port_buckets, 0, sizeof(tcp_port_buckets));
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -431,6 +622,9 @@ uip_init(void)
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
   }
+#if UIP_CONN_HASH
+  memset(udp_buckets, 0, sizeof(udp_buckets));
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_UDP */
 
 #if UIP_CONF_IPV6_MULTICAST
@@ -454,12 +648,8 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
 
   /* Check if this port is already in use, and if so try to find
      another one. */
-  for(c = 0; c < UIP_CONNS; ++c) {
-    conn = &uip_conns[c];
-    if(conn->tcpstateflags != UIP_CLOSED &&
-       conn->lport == uip_htons(lastport)) {
-      goto again;
-    }
+  if(tcp_port_in_use(uip_htons(lastport))) {
+    goto again;
   }
 
   conn = 0;
@@ -480,6 +670,7 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   if(conn == 0) {
     return 0;
   }
+  tcp_unhash(conn);
   
   conn->tcpstateflags = UIP_SYN_SENT;
 
@@ -497,6 +688,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   
   conn->len = 1;   /* TCP length of the SYN is one. */
   conn->nrtx = 0;
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(conn);
+#endif /* UIP_TCP_WINDOW */
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
   conn->sa = 0;
@@ -504,6 +698,7 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+  tcp_hash(conn);
   
   return conn;
 }
@@ -548,10 +743,8 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     lastport = 4096;
   }
   
-  for(c = 0; c < UIP_UDP_CONNS; ++c) {
-    if(uip_udp_conns[c].lport == uip_htons(lastport)) {
-      goto again;
-    }
+  if(udp_port_in_use(uip_htons(lastport))) {
+    goto again;
   }
 
   conn = 0;
@@ -566,7 +759,11 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     return 0;
   }
   
+#if UIP_CONN_HASH
+  uip_udp_set_lport(conn, UIP_HTONS(lastport));
+#else /* UIP_CONN_HASH */
   conn->lport = UIP_HTONS(lastport);
+#endif /* UIP_CONN_HASH */
   conn->rport = rport;
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
@@ -933,9 +1130,18 @@ uip_process(uint8_t flag)
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
+#if UIP_TCP_WINDOW
+    if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+       uip_tcp_window_open(uip_connr)) {
+      uip_flags = uip_tcp_window_appflags(uip_connr);
+      if(uip_flags == 0) {
+        uip_flags = UIP_POLL;
+      }
+#else /* UIP_TCP_WINDOW */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
       uip_flags = UIP_POLL;
+#endif /* UIP_TCP_WINDOW */
       UIP_APPCALL();
       goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -988,6 +1194,9 @@ uip_process(uint8_t flag)
                uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
               uip_connr->nrtx == UIP_MAXSYNRTX)) {
             uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+            uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
                   
             /*
              * We call UIP_APPCALL() with uip_flags set to
@@ -1030,6 +1239,15 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
                      
             case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW
+              /*
+               * With a retransmission queue, we retransmit the oldest
+               * segment ourselves and stop sending new data until
+               * all queued data has been acknowledged.
+               */
+              uip_connr->wflags |= UIP_TCPW_RECOVERY;
+              goto tcp_send_rexmit;
+#else /* UIP_TCP_WINDOW */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1039,6 +1257,7 @@ uip_process(uint8_t flag)
               uip_flags = UIP_REXMIT;
               UIP_APPCALL();
               goto apprexmit;
+#endif /* UIP_TCP_WINDOW */
                      
             case UIP_FIN_WAIT_1:
             case UIP_CLOSING:
@@ -1047,12 +1266,26 @@ uip_process(uint8_t flag)
               goto tcp_send_finack;
           }
         }
+#if UIP_TCP_WINDOW
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+         uip_tcp_window_open(uip_connr)) {
+        /*
+         * If there was no need for a retransmission, we poll the
+         * application for new data, also if there is data in flight.
+         */
+        uip_flags = uip_tcp_window_appflags(uip_connr);
+        if(uip_flags == 0) {
+          uip_flags = UIP_POLL;
+        }
+#else /* UIP_TCP_WINDOW */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
         /*
          * If there was no need for a retransmission, we poll the
          * application for new data.
          */
         uip_flags = UIP_POLL;
+#endif /* UIP_TCP_WINDOW */
         UIP_APPCALL();
         goto appsend;
       }
@@ -1481,24 +1714,9 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
-  for(uip_udp_conn = &uip_udp_conns[0];
-      uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
-      ++uip_udp_conn) {
-    /* If the local UDP port is non-zero, the connection is considered
-       to be used. If so, the local port number is checked against the
-       destination port number in the received packet. If the two port
-       numbers match, the remote port number is checked if the
-       connection is bound to a remote port. Finally, if the
-       connection is bound to a remote IP address, the source IP
-       address of the packet is checked. */
-    if(uip_udp_conn->lport != 0 &&
-       UIP_UDP_BUF->destport == uip_udp_conn->lport &&
-       (uip_udp_conn->rport == 0 ||
-        UIP_UDP_BUF->srcport == uip_udp_conn->rport) &&
-       (uip_is_addr_unspecified(&uip_udp_conn->ripaddr) ||
-        uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
-      goto udp_found;
-    }
+  uip_udp_conn = udp_lookup();
+  if(uip_udp_conn != NULL) {
+    goto udp_found;
   }
   PRINTF("udp: no matching connection found\n");
   UIP_STAT(++uip_stat.udp.drop);
@@ -1590,14 +1808,9 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
-  for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
-      ++uip_connr) {
-    if(uip_connr->tcpstateflags != UIP_CLOSED &&
-       UIP_TCP_BUF->destport == uip_connr->lport &&
-       UIP_TCP_BUF->srcport == uip_connr->rport &&
-       uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_connr->ripaddr)) {
-      goto found;
-    }
+  uip_connr = tcp_lookup();
+  if(uip_connr != NULL) {
+    goto found;
   }
 
   /* If we didn't find and active connection that expected the packet,
@@ -1704,6 +1917,7 @@ uip_process(uint8_t flag)
     UIP_LOG("tcp: found no unused connections.");
     goto drop;
   }
+  tcp_unhash(uip_connr);
   uip_conn = uip_connr;
   
   /* Fill in the necessary fields for the new connection. */
@@ -1714,6 +1928,7 @@ uip_process(uint8_t flag)
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
+  tcp_hash(uip_connr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
 
   uip_connr->snd_nxt[0] = iss[0];
@@ -1721,6 +1936,9 @@ uip_process(uint8_t flag)
   uip_connr->snd_nxt[2] = iss[2];
   uip_connr->snd_nxt[3] = iss[3];
   uip_connr->len = 1;
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 
   /* rcv_nxt should be the seqno from the incoming packet + 1. */
   uip_connr->rcv_nxt[3] = UIP_TCP_BUF->seqno[3];
@@ -1795,6 +2013,9 @@ uip_process(uint8_t flag)
      before we accept the reset. */
   if(UIP_TCP_BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1838,6 +2059,45 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_WINDOW
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+      UIP_TCP_BUF->wnd[1];
+  }
+  /* If data segments are in flight, the retransmission queue handles
+     the ACK. It does not set UIP_ACKDATA; the application is told
+     when its data was queued instead. */
+  if((UIP_TCP_BUF->flags & TCP_ACK) && uip_connr->rtxq != NULL) {
+    if(uip_tcp_window_ack(uip_connr, UIP_TCP_BUF->ackno, uip_len)) {
+      /* Do RTT estimation, unless we have done retransmissions. */
+      if(uip_connr->nrtx == 0 &&
+         !(uip_connr->wflags & UIP_TCPW_RECOVERY)) {
+        signed char m;
+        m = uip_connr->rto - uip_connr->timer;
+        m = m - (uip_connr->sa >> 3);
+        uip_connr->sa += m;
+        if(m < 0) {
+          m = -m;
+        }
+        m = m - (uip_connr->sv >> 2);
+        uip_connr->sv += m;
+        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
+      }
+      uip_connr->timer = uip_connr->rto;
+      uip_connr->nrtx = 0;
+
+      /* Send the FIN that the application asked for once all data has
+         been acknowledged. */
+      if(uip_connr->rtxq == NULL &&
+         (uip_connr->wflags & UIP_TCPW_CLOSEPENDING)) {
+        uip_connr->wflags &= ~UIP_TCPW_CLOSEPENDING;
+        uip_connr->len = 1;
+        uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
+        goto tcp_send_finack;
+      }
+    }
+  } else
+#endif /* UIP_TCP_WINDOW */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -2063,7 +2323,10 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
-      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+#if UIP_TCP_WINDOW
+      uip_flags |= uip_tcp_window_appflags(uip_connr);
+#endif /* UIP_TCP_WINDOW */
+      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT)) {
         uip_slen = 0;
         UIP_APPCALL();
 
@@ -2072,12 +2335,23 @@ uip_process(uint8_t flag)
         if(uip_flags & UIP_ABORT) {
           uip_slen = 0;
           uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+          uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
           UIP_TCP_BUF->flags = TCP_RST | TCP_ACK;
           goto tcp_send_nodata;
         }
 
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
+#if UIP_TCP_WINDOW
+          if(uip_connr->rtxq != NULL) {
+            /* The FIN is sent when the queued data has been
+               acknowledged. */
+            uip_connr->wflags |= UIP_TCPW_CLOSEPENDING;
+            goto appsend_window;
+          }
+#endif /* UIP_TCP_WINDOW */
           uip_connr->len = 1;
           uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
           uip_connr->nrtx = 0;
@@ -2085,6 +2359,35 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_WINDOW
+        /* If uip_slen > 0, the application has data to be sent. It is
+           sent if it fits in the retransmission queue. */
+        if(uip_slen > 0) {
+          if(uip_slen > uip_connr->mss) {
+            uip_slen = uip_connr->mss;
+          }
+          if(!uip_tcp_window_push(uip_connr, uip_sappdata, uip_slen)) {
+            uip_slen = 0;
+          }
+        }
+      appsend_window:
+        uip_appdata = uip_sappdata;
+        if(uip_connr->wflags & UIP_TCPW_REXMIT) {
+          goto tcp_send_rexmit;
+        }
+        if(uip_slen > 0) {
+          /* The new segment follows the segments already in flight. */
+          tcp_seqoff = uip_connr->len - uip_slen;
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+        if(uip_flags & UIP_NEWDATA) {
+          uip_len = UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK;
+          goto tcp_send_noopts;
+        }
+#else /* UIP_TCP_WINDOW */
         /* If uip_slen > 0, the application has data to be sent. */
         if(uip_slen > 0) {
 
@@ -2138,7 +2441,14 @@ uip_process(uint8_t flag)
           UIP_TCP_BUF->flags = TCP_ACK;
           goto tcp_send_noopts;
         }
+#endif /* UIP_TCP_WINDOW */
+      }
+#if UIP_TCP_WINDOW
+      /* A partial ACK during recovery or a third duplicate ACK. */
+      if(uip_connr->wflags & UIP_TCPW_REXMIT) {
+        goto tcp_send_rexmit;
       }
+#endif /* UIP_TCP_WINDOW */
       goto drop;
     case UIP_LAST_ACK:
       /* We can close this connection if the peer has acknowledged our
@@ -2207,6 +2517,18 @@ uip_process(uint8_t flag)
   }
   goto drop;
   
+#if UIP_TCP_WINDOW
+  /* Retransmit the oldest unacknowledged segment from the
+     retransmission queue. */
+ tcp_send_rexmit:
+  uip_len = uip_tcp_window_rexmit(uip_connr,
+                                  &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN]) +
+    UIP_TCPIP_HLEN;
+  tcp_seqoff = 0;
+  UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+  goto tcp_send_noopts;
+#endif /* UIP_TCP_WINDOW */
+
   /* We jump here when we are ready to send the packet, and just want
      to set the appropriate TCP sequence numbers in the TCP header. */
  tcp_send_ack:
@@ -2230,10 +2552,24 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
   
+#if UIP_TCP_WINDOW
+  /* Segments other than data segments carry the sequence number that
+     follows the data in flight. */
+  if(tcp_seqoff == TCP_SEQOFF_DEFAULT) {
+    tcp_seqoff = uip_connr->rtxq != NULL ? uip_connr->len : 0;
+  }
+  uip_add32(uip_connr->snd_nxt, tcp_seqoff);
+  tcp_seqoff = TCP_SEQOFF_DEFAULT;
+  UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+  UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+  UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+  UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+#else /* UIP_TCP_WINDOW */
   UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#endif /* UIP_TCP_WINDOW */
 
   UIP_IP_BUF->proto = UIP_PROTO_TCP;
 
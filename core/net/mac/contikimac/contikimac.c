@@ -106,7 +106,30 @@ static int we_are_receiving_burst = 0;
 
 /* INTER_PACKET_DEADLINE is the maximum time a receiver waits for the
    next packet of a burst when FRAME_PENDING is set. */
+#ifdef CONTIKIMAC_CONF_INTER_PACKET_DEADLINE
+#define INTER_PACKET_DEADLINE               CONTIKIMAC_CONF_INTER_PACKET_DEADLINE
+#else
 #define INTER_PACKET_DEADLINE               CLOCK_SECOND / 32
+#endif /* CONTIKIMAC_CONF_INTER_PACKET_DEADLINE */
+
+/* MAX_BURST is the maximum number of frames sent in one burst. Once
+   the receiver has acknowledged the first frame, the others follow
+   back-to-back with the radio kept on. */
+#ifdef CONTIKIMAC_CONF_MAX_BURST
+#define MAX_BURST                           CONTIKIMAC_CONF_MAX_BURST
+#else
+#define MAX_BURST                           16
+#endif /* CONTIKIMAC_CONF_MAX_BURST */
+
+/* Are we currently sending a burst? */
+static volatile uint8_t we_are_bursting = 0;
+
+/* Has the radio been left on for the next frame of a burst? */
+static uint8_t burst_radio_on = 0;
+
+#if CONTIKIMAC_CONF_STATS
+struct contikimac_stats contikimac_stats;
+#endif /* CONTIKIMAC_CONF_STATS */
 
 /* ContikiMAC performs periodic channel checks. Each channel check
    consists of two or more CCA checks. CCA_COUNT_MAX is the number of
@@ -195,6 +218,16 @@ static int we_are_receiving_burst = 0;
    to a neighbor for which we have a phase lock. */
 #define MAX_PHASE_STROBE_TIME              RTIMER_ARCH_SECOND / 60
 
+/* LOCKED_GUARD_TIME replaces GUARD_TIME for a neighbor whose phase has
+   been confirmed by PHASE_CONF_LOCK_COUNT acknowledgements in a row.
+   The strobe train to it is shortened by the same amount. */
+#ifdef CONTIKIMAC_CONF_LOCKED_GUARD_TIME
+#define LOCKED_GUARD_TIME                  CONTIKIMAC_CONF_LOCKED_GUARD_TIME
+#else
+#define LOCKED_GUARD_TIME                  ((GUARD_TIME) / 2)
+#endif /* CONTIKIMAC_CONF_LOCKED_GUARD_TIME */
+#define LOCKED_PHASE_STROBE_TIME           (MAX_PHASE_STROBE_TIME - (GUARD_TIME) + LOCKED_GUARD_TIME)
+
 #define ACK_LEN 3
 
 #include <stdio.h>
@@ -505,6 +538,8 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   int transmit_len;
   int ret;
   uint8_t contikimac_was_on;
+  uint8_t keep_radio_on;
+  rtimer_clock_t phase_strobe_time;
   uint8_t seqno;
   
   /* Exit if RDC and radio were explicitly turned off */
@@ -560,10 +595,16 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   transmit_len = packetbuf_totlen();
   NETSTACK_RADIO.prepare(packetbuf_hdrptr(), transmit_len);
   
+  phase_strobe_time = MAX_PHASE_STROBE_TIME;
   if(!is_broadcast && !is_receiver_awake) {
 #if WITH_PHASE_OPTIMIZATION
+    rtimer_clock_t guard_time = GUARD_TIME;
+    if(phase_is_locked(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))) {
+      guard_time = LOCKED_GUARD_TIME;
+      phase_strobe_time = LOCKED_PHASE_STROBE_TIME;
+    }
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
-                     CYCLE_TIME, GUARD_TIME,
+                     CYCLE_TIME, guard_time,
                      mac_callback, mac_callback_ptr, buf_list);
     if(ret == PHASE_DEFERRED) {
       return MAC_TX_DEFERRED;
@@ -593,8 +634,11 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
   
   /* Switch off the radio to ensure that we didn't start sending while
-     the radio was doing a channel check. */
-  off();
+     the radio was doing a channel check. In a burst, the radio was
+     left on for us after the previous frame. */
+  if(!is_receiver_awake) {
+    off();
+  }
 
 
   strobes = 0;
@@ -660,7 +704,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     watchdog_periodic();
 
     if(!is_broadcast && (is_receiver_awake || is_known_receiver) &&
-       !RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + MAX_PHASE_STROBE_TIME)) {
+       !RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + phase_strobe_time)) {
       PRINTF("miss to %d\n", packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
       break;
     }
@@ -717,7 +761,14 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     }
   }
 
-  off();
+  /* In a burst, keep the radio on for the next frame once the
+     receiver has acknowledged this one. qsend_list() turns it off
+     when the burst is over. */
+  keep_radio_on = we_are_bursting && got_strobe_ack;
+  burst_radio_on = keep_radio_on;
+  if(!keep_radio_on) {
+    off();
+  }
 
   PRINTF("contikimac: send (strobes=%u, len=%u, %s, %s), done\n", strobes,
          packetbuf_totlen(),
@@ -740,7 +791,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 #endif /* CONTIKIMAC_CONF_COMPOWER */
 
   contikimac_is_on = contikimac_was_on;
-  we_are_sending = 0;
+  we_are_sending = keep_radio_on;
 
   /* Determine the return value that we will return from the
      function. We must pass this value to the phase module before we
@@ -762,7 +813,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 
   if(!is_broadcast) {
     if(collisions == 0 && is_receiver_awake == 0) {
-      phase_update(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+      phase_update(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), CYCLE_TIME,
 		   encounter_time, ret);
     }
   }
@@ -787,6 +838,8 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
   struct rdc_buf_list *next;
   int ret;
   int is_receiver_awake;
+  int pending;
+  int count;
   
   if(buf_list == NULL) {
     return;
@@ -800,14 +853,15 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     return;
   }
   
-  /* Create and secure frames in advance */
+  /* Create and secure frames in advance, up to the burst length */
   curr = buf_list;
+  count = 0;
   do {
     next = list_item_next(curr);
-    queuebuf_to_packetbuf(curr->buf);
+    queuebuf_attach_to_packetbuf(curr->buf);
     if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
       /* create and secure this frame */
-      if(next != NULL) {
+      if(next != NULL && count + 1 < MAX_BURST) {
         packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
       }
       packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
@@ -821,19 +875,23 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       queuebuf_update_from_packetbuf(curr->buf);
     }
     curr = next;
-  } while(next != NULL);
+  } while(next != NULL && ++count < MAX_BURST);
   
   /* The receiver needs to be awoken before we send */
   is_receiver_awake = 0;
+  we_are_bursting = 1;
+  count = 0;
   curr = buf_list;
   do { /* A loop sending a burst of packets from buf_list */
     next = list_item_next(curr);
 
     /* Prepare the packetbuf */
-    queuebuf_to_packetbuf(curr->buf);
+    queuebuf_attach_to_packetbuf(curr->buf);
     
     /* Send the current packet */
     ret = send_packet(sent, ptr, curr, is_receiver_awake);
+    pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
+    count++;
     if(ret != MAC_TX_DEFERRED) {
       mac_call_sent_callback(sent, ptr, ret, 1);
     }
@@ -846,9 +904,27 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       }
     } else {
       /* The transmission failed, we stop the burst */
+      CONTIKIMAC_STAT(contikimac_stats.burst_failures += is_receiver_awake);
       next = NULL;
     }
-  } while((next != NULL) && packetbuf_attr(PACKETBUF_ATTR_PENDING));
+  } while(next != NULL && pending && count < MAX_BURST);
+
+  /* The burst is over. A frame that was not sent because of a
+     collision leaves the radio on as the previous frame did. */
+  we_are_bursting = 0;
+  if(burst_radio_on) {
+    burst_radio_on = 0;
+    we_are_sending = 0;
+    off();
+  }
+
+  if(count > 1) {
+    CONTIKIMAC_STAT(contikimac_stats.bursts++);
+    CONTIKIMAC_STAT(contikimac_stats.burst_frames += count);
+  }
+  if(next != NULL && pending) {
+    CONTIKIMAC_STAT(contikimac_stats.burst_limits++);
+  }
 }
 /*---------------------------------------------------------------------------*/
 /* Timer callback triggered when receiving a burst, after having
@@ -859,6 +935,7 @@ recv_burst_off(void *ptr)
 {
   off();
   we_are_receiving_burst = 0;
+  CONTIKIMAC_STAT(contikimac_stats.rx_burst_timeouts++);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -883,6 +960,9 @@ input_packet(void)
       /* If FRAME_PENDING is set, we are receiving a packets in a burst */
       /* TODO To prevent denial-of-sleep attacks, the transceiver should
          be disabled upon receipt of an unauthentic frame. */
+      if(!we_are_receiving_burst && packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
+        CONTIKIMAC_STAT(contikimac_stats.rx_bursts++);
+      }
       we_are_receiving_burst = packetbuf_attr(PACKETBUF_ATTR_PENDING);
       if(we_are_receiving_burst) {
         on();
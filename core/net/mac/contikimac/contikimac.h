@@ -46,4 +46,21 @@
 
 extern const struct rdc_driver contikimac_driver;
 
+#if CONTIKIMAC_CONF_STATS
+/* Burst statistics */
+struct contikimac_stats {
+  uint32_t bursts;            /* Bursts of more than one frame sent */
+  uint32_t burst_frames;      /* Frames sent in those bursts */
+  uint32_t burst_failures;    /* Bursts that failed after the first frame */
+  uint32_t burst_limits;      /* Bursts cut at CONTIKIMAC_CONF_MAX_BURST */
+  uint32_t rx_bursts;         /* Bursts received */
+  uint32_t rx_burst_timeouts; /* Bursts that ended by timeout */
+};
+
+extern struct contikimac_stats contikimac_stats;
+#define CONTIKIMAC_STAT(code) (code)
+#else /* CONTIKIMAC_CONF_STATS */
+#define CONTIKIMAC_STAT(code)
+#endif /* CONTIKIMAC_CONF_STATS */
+
 #endif /* CONTIKIMAC_H */
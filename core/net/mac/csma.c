@@ -89,6 +89,14 @@ struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+#if CSMA_FAIR
+  uint8_t priority;
+#endif /* CSMA_FAIR */
+#if CSMA_HASH
+  struct rdc_buf_list *hash_next;
+  struct neighbor_queue *n;
+  uint16_t seqno;
+#endif /* CSMA_HASH */
 };
 
 /* Every neighbor has its own packet queue */
@@ -98,6 +106,18 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+#if CSMA_HASH
+  struct neighbor_queue *hash_next;
+#endif /* CSMA_HASH */
+#if CSMA_FAIR
+  struct neighbor_queue *ready_next;
+  int16_t deficit;
+  uint8_t ready;
+  uint8_t data_queued;
+#endif /* CSMA_FAIR */
+#if CSMA_CONF_STATS
+  struct neighbor_stats *stats;
+#endif /* CSMA_CONF_STATS */
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -114,13 +134,128 @@ MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+#if CSMA_FAIR
+#if CSMA_CONTROL_RESERVE >= MAX_QUEUED_PACKETS
+#error CSMA_CONF_CONTROL_RESERVE must be smaller than QUEUEBUF_NUM.
+#endif /* CSMA_CONTROL_RESERVE >= MAX_QUEUED_PACKETS */
+#define CSMA_DATA_LIMIT (MAX_QUEUED_PACKETS - CSMA_CONTROL_RESERVE)
+
+/* Neighbors whose transmit timer has fired wait on the ready list
+   until dispatch() hands their queue to the RDC layer. */
+static struct neighbor_queue *ready_head;
+static struct ctimer dispatch_timer;
+
+/* Data packets queued, and the number of neighbors they are queued
+   for */
+static uint8_t data_queued;
+static uint8_t data_neighbors;
+#endif /* CSMA_FAIR */
+
+#if CSMA_HASH
+/* Neighbor queues are hashed by link-layer address. Queued packets
+   are hashed by their MAC sequence number, which the RDC layer leaves
+   in the packetbuf when it calls packet_sent(): the callback pointer
+   is the same for every frame of a burst, the sequence number is
+   not. */
+static struct neighbor_queue *neighbor_hash[CSMA_HASH_SIZE];
+static struct rdc_buf_list *packet_hash[CSMA_HASH_SIZE];
+#define NEIGHBOR_HASH(addr) \
+  (((addr)->u8[LINKADDR_SIZE - 2] << 8 | (addr)->u8[LINKADDR_SIZE - 1]) % \
+   CSMA_HASH_SIZE)
+#define PACKET_HASH(seqno) ((seqno) % CSMA_HASH_SIZE)
+#endif /* CSMA_HASH */
+
+#if CSMA_CONF_STATS
+struct csma_stats csma_stats;
+
+/* Per-neighbor statistics outlive the neighbor queue, so they are kept
+   in a pool of their own, most recently used first. An entry is in use
+   while the neighbor has a queue, and is otherwise reused for another
+   neighbor once it is the least recently used. They are not kept in an
+   nbr-table, since adding an entry there could evict neighbors that
+   other tables such as the IPv6 neighbor cache still need. */
+struct neighbor_stats {
+  struct neighbor_stats *next;
+  linkaddr_t addr;
+  uint8_t in_use;
+  struct csma_neighbor_stats stats;
+};
+
+MEMB(stats_memb, struct neighbor_stats, CSMA_STATS_NEIGHBORS);
+LIST(stats_list);
+
+#define NEIGHBOR_STAT(n, code) do {             \
+    if((n)->stats != NULL) {                    \
+      (n)->stats->stats.code;                   \
+    }                                           \
+  } while(0)
+#else /* CSMA_CONF_STATS */
+#define NEIGHBOR_STAT(n, code)
+#endif /* CSMA_CONF_STATS */
+
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 
+/*---------------------------------------------------------------------------*/
+#if CSMA_CONF_STATS
+static struct neighbor_stats *
+neighbor_stats_from_addr(const linkaddr_t *addr)
+{
+  struct neighbor_stats *s;
+
+  for(s = list_head(stats_list); s != NULL; s = s->next) {
+    if(linkaddr_cmp(&s->addr, addr)) {
+      return s;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Get the statistics for a neighbor that is given a queue. Returns
+   NULL if all entries are in use by other queues. */
+static struct neighbor_stats *
+neighbor_stats_get(const linkaddr_t *addr)
+{
+  struct neighbor_stats *s, *unused;
+
+  s = neighbor_stats_from_addr(addr);
+  if(s == NULL) {
+    s = memb_alloc(&stats_memb);
+    if(s == NULL) {
+      /* Reuse the least recently used entry. */
+      unused = NULL;
+      for(s = list_head(stats_list); s != NULL; s = s->next) {
+        if(!s->in_use) {
+          unused = s;
+        }
+      }
+      s = unused;
+      if(s == NULL) {
+        return NULL;
+      }
+    }
+    linkaddr_copy(&s->addr, addr);
+    memset(&s->stats, 0, sizeof(s->stats));
+  }
+  list_remove(stats_list, s);
+  list_push(stats_list, s);
+  s->in_use = 1;
+  return s;
+}
+#endif /* CSMA_CONF_STATS */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
+#if CSMA_HASH
+  struct neighbor_queue *n = neighbor_hash[NEIGHBOR_HASH(addr)];
+  while(n != NULL) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+    n = n->hash_next;
+  }
+#else /* CSMA_HASH */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
@@ -128,6 +263,191 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
     }
     n = list_item_next(n);
   }
+#endif /* CSMA_HASH */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_add(struct neighbor_queue *n)
+{
+  list_add(neighbor_list, n);
+#if CSMA_HASH
+  n->hash_next = neighbor_hash[NEIGHBOR_HASH(&n->addr)];
+  neighbor_hash[NEIGHBOR_HASH(&n->addr)] = n;
+#endif /* CSMA_HASH */
+}
+/*---------------------------------------------------------------------------*/
+#if CSMA_FAIR
+static void
+ready_add(struct neighbor_queue *n)
+{
+  struct neighbor_queue **pp;
+
+  if(!n->ready) {
+    for(pp = &ready_head; *pp != NULL; pp = &(*pp)->ready_next);
+    n->ready_next = NULL;
+    *pp = n;
+    n->ready = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+ready_remove(struct neighbor_queue *n)
+{
+  struct neighbor_queue **pp;
+
+  if(n->ready) {
+    for(pp = &ready_head; *pp != NULL; pp = &(*pp)->ready_next) {
+      if(*pp == n) {
+        *pp = n->ready_next;
+        break;
+      }
+    }
+    n->ready = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+packet_priority(struct rdc_buf_list *q)
+{
+  return ((struct qbuf_metadata *)q->ptr)->priority;
+}
+/*---------------------------------------------------------------------------*/
+/* Queue control packets behind the packet being sent and any control
+   packets already queued, data packets at the end. */
+static void
+queue_packet(struct neighbor_queue *n, struct rdc_buf_list *q)
+{
+  struct rdc_buf_list *prev;
+
+  prev = list_head(n->queued_packet_list);
+  if(prev == NULL || packet_priority(q) != PACKETBUF_ATTR_PRIORITY_CONTROL) {
+    list_add(n->queued_packet_list, q);
+    return;
+  }
+  while(list_item_next(prev) != NULL &&
+        packet_priority(list_item_next(prev)) ==
+        PACKETBUF_ATTR_PRIORITY_CONTROL) {
+    prev = list_item_next(prev);
+  }
+  list_insert(n->queued_packet_list, prev, q);
+}
+/*---------------------------------------------------------------------------*/
+/* Decide whether a packet of the given priority may be queued for n.
+   Data may not use the buffers reserved for control packets, and once
+   half of the data buffers are in use, a neighbor that holds more than
+   its share of them gets no more. */
+static int
+admit_packet(struct neighbor_queue *n, uint8_t priority)
+{
+  if(priority == PACKETBUF_ATTR_PRIORITY_CONTROL) {
+    return 1;
+  }
+  if(data_queued >= CSMA_DATA_LIMIT) {
+    return 0;
+  }
+  if(data_queued >= CSMA_DATA_LIMIT / 2 &&
+     n->data_queued * data_neighbors > data_queued) {
+    PRINTF("csma: early drop, %d of %d data packets queued\n",
+           n->data_queued, data_queued);
+    NEIGHBOR_STAT(n, early_drops++);
+    CSMA_STAT(csma_stats.early_drops++);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dispatch(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q;
+
+  /* Control packets go first, in the order their neighbors became
+     ready. */
+  for(n = ready_head; n != NULL; n = n->ready_next) {
+    q = list_head(n->queued_packet_list);
+    if(q != NULL && packet_priority(q) == PACKETBUF_ATTR_PRIORITY_CONTROL) {
+      break;
+    }
+  }
+
+  if(n == NULL) {
+    /* Deficit round robin: a neighbor that has used up its deficit is
+       given another quantum and goes to the back of the list. The
+       deficit is charged in packet_sent(), so a burst sent by the RDC
+       layer is charged in full. */
+    while((n = ready_head) != NULL && n->deficit <= 0) {
+      n->deficit += CSMA_QUANTUM;
+      ready_remove(n);
+      ready_add(n);
+    }
+  }
+
+  if(n != NULL) {
+    ready_remove(n);
+    q = list_head(n->queued_packet_list);
+    if(q != NULL) {
+      NETSTACK_RDC.send_list(packet_sent, n, q);
+    }
+  }
+
+  if(ready_head != NULL) {
+    ctimer_set(&dispatch_timer, 0, dispatch, NULL);
+  }
+}
+#endif /* CSMA_FAIR */
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+#if CSMA_HASH
+  struct neighbor_queue **pp;
+
+  for(pp = &neighbor_hash[NEIGHBOR_HASH(&n->addr)];
+      *pp != NULL; pp = &(*pp)->hash_next) {
+    if(*pp == n) {
+      *pp = n->hash_next;
+      break;
+    }
+  }
+#endif /* CSMA_HASH */
+#if CSMA_FAIR
+  ready_remove(n);
+#endif /* CSMA_FAIR */
+#if CSMA_CONF_STATS
+  if(n->stats != NULL) {
+    n->stats->in_use = 0;
+  }
+#endif /* CSMA_CONF_STATS */
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
+/*---------------------------------------------------------------------------*/
+/* Find the queued packet that the current packetbuf refers to */
+static struct rdc_buf_list *
+packet_from_packetbuf(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q;
+#if CSMA_HASH
+  struct qbuf_metadata *metadata;
+  uint16_t seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+
+  for(q = packet_hash[PACKET_HASH(seqno)]; q != NULL; q = metadata->hash_next) {
+    metadata = q->ptr;
+    if(metadata->seqno == seqno && metadata->n == n) {
+      return q;
+    }
+  }
+#else /* CSMA_HASH */
+  for(q = list_head(n->queued_packet_list);
+      q != NULL; q = list_item_next(q)) {
+    if(queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO) ==
+       packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
+      return q;
+    }
+  }
+#endif /* CSMA_HASH */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -157,8 +477,14 @@ transmit_packet_list(void *ptr)
     if(q != NULL) {
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+#if CSMA_FAIR
+      /* Wait for our turn */
+      ready_add(n);
+      ctimer_set(&dispatch_timer, 0, dispatch, NULL);
+#else /* CSMA_FAIR */
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
+#endif /* CSMA_FAIR */
     }
   }
 }
@@ -169,6 +495,29 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
   if(p != NULL) {
     /* Remove packet from list and deallocate */
     list_remove(n->queued_packet_list, p);
+#if CSMA_HASH
+    {
+      struct qbuf_metadata *metadata = p->ptr;
+      struct rdc_buf_list **pp;
+
+      for(pp = &packet_hash[PACKET_HASH(metadata->seqno)]; *pp != NULL;
+          pp = &((struct qbuf_metadata *)(*pp)->ptr)->hash_next) {
+        if(*pp == p) {
+          *pp = metadata->hash_next;
+          break;
+        }
+      }
+    }
+#endif /* CSMA_HASH */
+    NEIGHBOR_STAT(n, queued--);
+#if CSMA_FAIR
+    if(packet_priority(p) == PACKETBUF_ATTR_PRIORITY_DATA) {
+      data_queued--;
+      if(--n->data_queued == 0) {
+        data_neighbors--;
+      }
+    }
+#endif /* CSMA_FAIR */
 
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
@@ -186,8 +535,7 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -223,16 +571,13 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 
   /* Find out what packet this callback refers to */
-  for(q = list_head(n->queued_packet_list);
-      q != NULL; q = list_item_next(q)) {
-    if(queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO) ==
-       packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
-      break;
-    }
-  }
+  q = packet_from_packetbuf(n);
 
   if(q != NULL) {
     metadata = (struct qbuf_metadata *)q->ptr;
+#if CSMA_FAIR
+    n->deficit -= queuebuf_datalen(q->buf);
+#endif /* CSMA_FAIR */
 
     if(metadata != NULL) {
       sent = metadata->sent;
@@ -286,6 +631,8 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          NEIGHBOR_STAT(n, drops++);
+          CSMA_STAT(csma_stats.drops++);
           free_packet(n, q);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -307,6 +654,9 @@ send_packet(mac_callback_t sent, void *ptr)
 {
   struct rdc_buf_list *q;
   struct neighbor_queue *n;
+#if CSMA_FAIR
+  uint8_t priority;
+#endif /* CSMA_FAIR */
   static uint8_t initialized = 0;
   static uint16_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -335,16 +685,31 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_FAIR
+      n->ready = 0;
+      n->deficit = 0;
+      n->data_queued = 0;
+#endif /* CSMA_FAIR */
+#if CSMA_CONF_STATS
+      n->stats = neighbor_stats_get(addr);
+#endif /* CSMA_CONF_STATS */
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      neighbor_queue_add(n);
     }
   }
 
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
+#if CSMA_FAIR
+    priority = packetbuf_attr(PACKETBUF_ATTR_PRIORITY) ==
+      PACKETBUF_ATTR_PRIORITY_CONTROL ? PACKETBUF_ATTR_PRIORITY_CONTROL :
+      PACKETBUF_ATTR_PRIORITY_DATA;
+    q = admit_packet(n, priority) ? memb_alloc(&packet_memb) : NULL;
+#else /* CSMA_FAIR */
     q = memb_alloc(&packet_memb);
+#endif /* CSMA_FAIR */
     if(q != NULL) {
       q->ptr = memb_alloc(&metadata_memb);
       if(q->ptr != NULL) {
@@ -361,12 +726,38 @@ send_packet(mac_callback_t sent, void *ptr)
 	  }
 	  metadata->sent = sent;
 	  metadata->cptr = ptr;
+#if CSMA_FAIR
+	  metadata->priority = priority;
+	  if(priority == PACKETBUF_ATTR_PRIORITY_DATA) {
+	    data_queued++;
+	    if(n->data_queued++ == 0) {
+	      data_neighbors++;
+	    }
+	  }
+#endif /* CSMA_FAIR */
+#if CSMA_HASH
+	  metadata->n = n;
+	  metadata->seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+	  metadata->hash_next = packet_hash[PACKET_HASH(metadata->seqno)];
+	  packet_hash[PACKET_HASH(metadata->seqno)] = q;
+#endif /* CSMA_HASH */
+#if CSMA_CONF_STATS
+	  if(n->stats != NULL &&
+	     ++n->stats->stats.queued > n->stats->stats.max_queued) {
+	    n->stats->stats.max_queued = n->stats->stats.queued;
+	  }
+	  csma_stats.queued++;
+#endif /* CSMA_CONF_STATS */
 
 	  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
 	     PACKETBUF_ATTR_PACKET_TYPE_ACK) {
 	    list_push(n->queued_packet_list, q);
 	  } else {
+#if CSMA_FAIR
+	    queue_packet(n, q);
+#else /* CSMA_FAIR */
 	    list_add(n->queued_packet_list, q);
+#endif /* CSMA_FAIR */
 	  }
 
 	  /* If q is the first packet in the neighbor's queue, send asap */
@@ -382,17 +773,27 @@ send_packet(mac_callback_t sent, void *ptr)
       PRINTF("csma: could not allocate queuebuf, dropping packet\n");
     }
     /* The packet allocation failed. Remove and free neighbor entry if empty. */
+    NEIGHBOR_STAT(n, overflows++);
     if(list_length(n->queued_packet_list) == 0) {
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+  CSMA_STAT(csma_stats.overflows++);
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_CONF_STATS
+const struct csma_neighbor_stats *
+csma_neighbor_stats(const linkaddr_t *addr)
+{
+  struct neighbor_stats *s = neighbor_stats_from_addr(addr);
+  return s != NULL ? &s->stats : NULL;
+}
+#endif /* CSMA_CONF_STATS */
+/*---------------------------------------------------------------------------*/
 static void
 input_packet(void)
 {
@@ -426,6 +827,19 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+#if CSMA_CONF_STATS
+  memb_init(&stats_memb);
+  list_init(stats_list);
+#endif /* CSMA_CONF_STATS */
+#if CSMA_HASH
+  memset(neighbor_hash, 0, sizeof(neighbor_hash));
+  memset(packet_hash, 0, sizeof(packet_hash));
+#endif /* CSMA_HASH */
+#if CSMA_FAIR
+  ready_head = NULL;
+  data_queued = 0;
+  data_neighbors = 0;
+#endif /* CSMA_FAIR */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
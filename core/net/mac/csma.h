@@ -43,6 +43,76 @@
 
 #include "net/mac/mac.h"
 #include "dev/radio.h"
+#include "net/linkaddr.h"
+
+/* Hash neighbor queues by link-layer address and queued packets by
+   MAC sequence number, instead of searching lists. 0 disables. */
+#ifdef CSMA_CONF_HASH_SIZE
+#define CSMA_HASH_SIZE CSMA_CONF_HASH_SIZE
+#else /* CSMA_CONF_HASH_SIZE */
+#define CSMA_HASH_SIZE 0
+#endif /* CSMA_CONF_HASH_SIZE */
+
+#define CSMA_HASH (CSMA_HASH_SIZE > 0)
+
+/* Scheduling mode: control packets (PACKETBUF_ATTR_PRIORITY) are
+   queued ahead of data, neighbors take turns by deficit round robin,
+   and data may not use the packet buffers reserved for control. */
+#ifdef CSMA_CONF_FAIR
+#define CSMA_FAIR CSMA_CONF_FAIR
+#else /* CSMA_CONF_FAIR */
+#define CSMA_FAIR 0
+#endif /* CSMA_CONF_FAIR */
+
+/* Bytes a neighbor may send per round */
+#ifdef CSMA_CONF_QUANTUM
+#define CSMA_QUANTUM CSMA_CONF_QUANTUM
+#else /* CSMA_CONF_QUANTUM */
+#define CSMA_QUANTUM 127
+#endif /* CSMA_CONF_QUANTUM */
+
+/* Packet buffers only control packets may use */
+#ifdef CSMA_CONF_CONTROL_RESERVE
+#define CSMA_CONTROL_RESERVE CSMA_CONF_CONTROL_RESERVE
+#else /* CSMA_CONF_CONTROL_RESERVE */
+#define CSMA_CONTROL_RESERVE 2
+#endif /* CSMA_CONF_CONTROL_RESERVE */
+
+#if CSMA_CONF_STATS
+/* Neighbors that statistics are kept for */
+#ifdef CSMA_CONF_STATS_NEIGHBORS
+#define CSMA_STATS_NEIGHBORS CSMA_CONF_STATS_NEIGHBORS
+#else /* CSMA_CONF_STATS_NEIGHBORS */
+#define CSMA_STATS_NEIGHBORS 8
+#endif /* CSMA_CONF_STATS_NEIGHBORS */
+
+/* Statistics for a neighbor. They are kept after the neighbor's queue
+   drains, until the entry is needed for another neighbor. */
+struct csma_neighbor_stats {
+  uint8_t queued;
+  uint8_t max_queued;
+  uint16_t drops;     /* Dropped after the last retransmission */
+  uint16_t overflows; /* Dropped because no buffer was available */
+  uint16_t early_drops; /* Data dropped to stay within the fair share */
+};
+
+/* Totals over all neighbors. */
+struct csma_stats {
+  uint32_t queued;
+  uint32_t drops;
+  uint32_t overflows;
+  uint32_t early_drops;
+};
+
+extern struct csma_stats csma_stats;
+
+/* Returns NULL if no statistics are kept for addr. */
+const struct csma_neighbor_stats *csma_neighbor_stats(const linkaddr_t *addr);
+
+#define CSMA_STAT(code) (code)
+#else /* CSMA_CONF_STATS */
+#define CSMA_STAT(code)
+#endif /* CSMA_CONF_STATS */
 
 extern const struct mac_driver csma_driver;
 
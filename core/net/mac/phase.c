@@ -50,11 +50,59 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* PHASE_LOCK_COUNT is the number of acknowledged transmissions in a
+   row after which the phase of a neighbor is considered locked, so
+   that the RDC can use a shorter guard time. 0 disables locking. */
+#ifdef PHASE_CONF_LOCK_COUNT
+#define PHASE_LOCK_COUNT PHASE_CONF_LOCK_COUNT
+#else
+#define PHASE_LOCK_COUNT 0
+#endif
+
+/* PHASE_EXPIRY is the time, in seconds, after which a phase that has
+   not been confirmed by an acknowledgement is dropped. 0 disables
+   expiry. */
+#ifdef PHASE_CONF_EXPIRY
+#define PHASE_EXPIRY PHASE_CONF_EXPIRY
+#else
+#define PHASE_EXPIRY 0
+#endif
+
+/* With PHASE_PERSIST, the neighbors and their drift estimates are
+   saved to a CFS file every PHASE_PERSIST_INTERVAL, if they have
+   changed, and restored at boot. */
+#if PHASE_CONF_PERSIST
+#define PHASE_PERSIST PHASE_CONF_PERSIST
+#else
+#define PHASE_PERSIST 0
+#endif
+
+#ifdef PHASE_CONF_PERSIST_FILE
+#define PHASE_PERSIST_FILE PHASE_CONF_PERSIST_FILE
+#else
+#define PHASE_PERSIST_FILE "phase"
+#endif
+
+#ifdef PHASE_CONF_PERSIST_INTERVAL
+#define PHASE_PERSIST_INTERVAL PHASE_CONF_PERSIST_INTERVAL
+#else
+#define PHASE_PERSIST_INTERVAL (CLOCK_SECOND * 60 * 5)
+#endif
+
+#if PHASE_PERSIST
+#include "cfs/cfs.h"
+#endif /* PHASE_PERSIST */
+
 struct phase {
   rtimer_clock_t time;
+  unsigned long updated;
 #if PHASE_DRIFT_CORRECT
-  rtimer_clock_t drift;
+  int16_t drift;
+#endif
+#if PHASE_PERSIST
+  uint8_t anchored;
 #endif
+  uint8_t confirmed;
   uint8_t noacks;
   struct timer noacks_timer;
 };
@@ -74,6 +122,31 @@ struct phase_queueitem {
 
 #define MAX_NOACKS_TIME       CLOCK_SECOND * 30
 
+#if PHASE_DRIFT_CORRECT
+/* The drift is kept in 1/256 rtimer ticks per cycle. A new sample is
+   only taken over at least DRIFT_MIN_CYCLES cycles, because the
+   encounter time is only as precise as the strobe interval, and moves
+   the estimate by 1/DRIFT_GAIN of its error. */
+#define DRIFT_SCALE           256
+#define DRIFT_MIN_CYCLES      256
+#define DRIFT_GAIN            8
+#define DRIFT_MAX             (4 * DRIFT_SCALE)
+#define DRIFT_MAX_CYCLES      (1UL << 20)
+#endif /* PHASE_DRIFT_CORRECT */
+
+#if PHASE_PERSIST
+struct phase_record {
+  linkaddr_t addr;
+  int16_t drift;
+};
+
+static struct ctimer persist_timer;
+static uint8_t dirty;
+#define SET_DIRTY() (dirty = 1)
+#else /* PHASE_PERSIST */
+#define SET_DIRTY()
+#endif /* PHASE_PERSIST */
+
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 NBR_TABLE(struct phase, nbr_phase);
 
@@ -87,9 +160,71 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+/* The number of cycles since the phase was last confirmed. This has a
+   resolution of one second, which is plenty for the drift. */
+static uint32_t
+cycles_since(const struct phase *e, rtimer_clock_t cycle_time)
+{
+  uint32_t cycles;
+
+  cycles = (clock_seconds() - e->updated) * (RTIMER_ARCH_SECOND / cycle_time);
+  return cycles < DRIFT_MAX_CYCLES ? cycles : DRIFT_MAX_CYCLES;
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
+/* A past wake-up time of the neighbor, corrected for the drift of its
+   clock since the phase was last confirmed. */
+static rtimer_clock_t
+expected_phase(const struct phase *e, rtimer_clock_t cycle_time)
+{
+#if PHASE_DRIFT_CORRECT
+  return e->time + (rtimer_clock_t)((int32_t)e->drift *
+                                    (int32_t)cycles_since(e, cycle_time) /
+                                    DRIFT_SCALE);
+#else /* PHASE_DRIFT_CORRECT */
+  return e->time;
+#endif /* PHASE_DRIFT_CORRECT */
+}
+/*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+static void
+update_drift(struct phase *e, rtimer_clock_t cycle_time, rtimer_clock_t time)
+{
+  uint32_t cycles;
+  int32_t offset;
+  int32_t drift;
+
+  cycles = cycles_since(e, cycle_time);
+  if(cycles < DRIFT_MIN_CYCLES || cycles >= DRIFT_MAX_CYCLES) {
+    return;
+  }
+
+  /* How far the neighbor woke up from where we expected it, within
+     half a cycle either way. */
+  offset = (rtimer_clock_t)(time - expected_phase(e, cycle_time)) % cycle_time;
+  if(offset > cycle_time / 2) {
+    offset -= (int32_t)cycle_time;
+  }
+
+  drift = e->drift + offset * DRIFT_SCALE / (int32_t)cycles / DRIFT_GAIN;
+  if(drift > DRIFT_MAX) {
+    drift = DRIFT_MAX;
+  } else if(drift < -DRIFT_MAX) {
+    drift = -DRIFT_MAX;
+  }
+  PRINTF("phase drift %d -> %ld (offset %ld over %lu cycles)\n",
+         e->drift, (long)drift, (long)offset, (unsigned long)cycles);
+  if(e->drift != drift) {
+    e->drift = drift;
+    SET_DIRTY();
+  }
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
 void
-phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
-             int mac_status)
+phase_update(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
+             rtimer_clock_t time, int mac_status)
 {
   struct phase *e;
 
@@ -97,16 +232,29 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
+#if PHASE_PERSIST
+      if(!e->anchored) {
+        /* A restored entry: this is its first phase since boot. */
+        e->anchored = 1;
+      } else
+#endif /* PHASE_PERSIST */
+      {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
-#endif
+        update_drift(e, cycle_time, time);
+#endif /* PHASE_DRIFT_CORRECT */
+        if(e->confirmed < 0xff) {
+          e->confirmed++;
+        }
+      }
       e->time = time;
+      e->updated = clock_seconds();
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
        before we drop it from the phase list. */
     if(mac_status == MAC_TX_NOACK) {
       PRINTF("phase noacks %d to %d.%d\n", e->noacks, neighbor->u8[0], neighbor->u8[1]);
+      e->confirmed = 0;
       e->noacks++;
       if(e->noacks == 1) {
         timer_set(&e->noacks_timer, MAX_NOACKS_TIME);
@@ -114,6 +262,7 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
         nbr_table_remove(nbr_phase, e);
+        SET_DIRTY();
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -125,15 +274,50 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       e = nbr_table_add_lladdr(nbr_phase, neighbor);
       if(e) {
         e->time = time;
+        e->updated = clock_seconds();
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+        e->drift = 0;
 #endif
-      e->noacks = 0;
+#if PHASE_PERSIST
+        e->anchored = 1;
+#endif
+        e->confirmed = 1;
+        e->noacks = 0;
+        SET_DIRTY();
       }
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+phase_is_locked(const linkaddr_t *neighbor)
+{
+#if PHASE_LOCK_COUNT
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  return e != NULL &&
+#if PHASE_PERSIST
+    e->anchored &&
+#endif /* PHASE_PERSIST */
+    e->noacks == 0 && e->confirmed >= PHASE_LOCK_COUNT;
+#else /* PHASE_LOCK_COUNT */
+  return 0;
+#endif /* PHASE_LOCK_COUNT */
+}
+/*---------------------------------------------------------------------------*/
+void
+phase_remove(const linkaddr_t *neighbor)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL) {
+    nbr_table_remove(nbr_phase, e);
+    SET_DIRTY();
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(void *ptr)
 {
@@ -163,6 +347,20 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
   e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+#if PHASE_EXPIRY
+  if(e != NULL && clock_seconds() - e->updated > PHASE_EXPIRY) {
+    PRINTF("phase expired %d\n", neighbor->u8[0]);
+    nbr_table_remove(nbr_phase, e);
+    SET_DIRTY();
+    e = NULL;
+  }
+#endif /* PHASE_EXPIRY */
+#if PHASE_PERSIST
+  if(e != NULL && !e->anchored) {
+    /* Restored at boot, but the phase itself is not known yet. */
+    e = NULL;
+  }
+#endif /* PHASE_PERSIST */
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
@@ -183,18 +381,7 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
     
     now = RTIMER_NOW();
 
-    sync = (e == NULL) ? now : e->time;
-
-#if PHASE_DRIFT_CORRECT
-    {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
-      }
-    }
-#endif
+    sync = expected_phase(e, cycle_time);
 
     /* Check if cycle_time is a power of two */
     if(!(cycle_time & (cycle_time - 1))) {
@@ -238,10 +425,85 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
   return PHASE_UNKNOWN;
 }
 /*---------------------------------------------------------------------------*/
+#if PHASE_PERSIST
+static void
+persist_save(void *ptr)
+{
+  struct phase *e;
+  struct phase_record r;
+  int fd;
+
+  ctimer_reset(&persist_timer);
+  if(!dirty) {
+    return;
+  }
+
+  cfs_remove(PHASE_PERSIST_FILE);
+  fd = cfs_open(PHASE_PERSIST_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("phase: could not open %s\n", PHASE_PERSIST_FILE);
+    return;
+  }
+  for(e = nbr_table_head(nbr_phase); e != NULL; e = nbr_table_next(nbr_phase, e)) {
+    linkaddr_copy(&r.addr, nbr_table_get_lladdr(nbr_phase, e));
+#if PHASE_DRIFT_CORRECT
+    r.drift = e->drift;
+#else /* PHASE_DRIFT_CORRECT */
+    r.drift = 0;
+#endif /* PHASE_DRIFT_CORRECT */
+    if(cfs_write(fd, &r, sizeof(r)) != sizeof(r)) {
+      PRINTF("phase: could not write %s\n", PHASE_PERSIST_FILE);
+      break;
+    }
+  }
+  cfs_close(fd);
+  dirty = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Our rtimer starts over at boot, so the saved phases would be
+   meaningless. What survives is the drift of each neighbor: the entry
+   is restored unanchored, and the first acknowledgement from the
+   neighbor gives it a drift corrected phase. The neighbor may have
+   rebooted as well, so the phase must be confirmed PHASE_LOCK_COUNT
+   times again before it is locked. */
+static void
+persist_load(void)
+{
+  struct phase *e;
+  struct phase_record r;
+  int fd;
+
+  fd = cfs_open(PHASE_PERSIST_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  while(cfs_read(fd, &r, sizeof(r)) == sizeof(r)) {
+    e = nbr_table_add_lladdr(nbr_phase, &r.addr);
+    if(e == NULL) {
+      break;
+    }
+    e->time = 0;
+    e->updated = clock_seconds();
+#if PHASE_DRIFT_CORRECT
+    e->drift = r.drift;
+#endif /* PHASE_DRIFT_CORRECT */
+    e->anchored = 0;
+    e->confirmed = 0;
+    e->noacks = 0;
+  }
+  cfs_close(fd);
+}
+#endif /* PHASE_PERSIST */
+/*---------------------------------------------------------------------------*/
 void
 phase_init(void)
 {
   memb_init(&queued_packets_memb);
   nbr_table_register(nbr_phase, NULL);
+#if PHASE_PERSIST
+  persist_load();
+  dirty = 0;
+  ctimer_set(&persist_timer, PHASE_PERSIST_INTERVAL, persist_save, NULL);
+#endif /* PHASE_PERSIST */
 }
 /*---------------------------------------------------------------------------*/
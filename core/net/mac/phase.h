@@ -59,8 +59,13 @@ phase_status_t phase_wait(const linkaddr_t *neighbor,
                           rtimer_clock_t cycle_time, rtimer_clock_t wait_before,
                           mac_callback_t mac_callback, void *mac_callback_ptr,
                           struct rdc_buf_list *buf_list);
-void phase_update(const linkaddr_t *neighbor,
+void phase_update(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
                   rtimer_clock_t time, int mac_status);
 void phase_remove(const linkaddr_t *neighbor);
 
+/* Returns non-zero if the phase of the neighbor has been confirmed by
+   PHASE_CONF_LOCK_COUNT acknowledgements in a row, so that a shorter
+   guard time can be used. */
+int phase_is_locked(const linkaddr_t *neighbor);
+
 #endif /* PHASE_H */
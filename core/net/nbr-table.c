@@ -62,6 +62,15 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+/* Hash index from link-layer address to neighbor index, with linear
+ * probing. A slot holds the neighbor index + 1, or 0 if empty. */
+static uint16_t hash_index[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -104,17 +113,94 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_HASH
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static int
+hash_slot(const linkaddr_t *lladdr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 5) - h + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor key to the hash index */
+static void
+hash_add(nbr_table_key_t *key)
+{
+  int slot;
+
+  slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor key from the hash index */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int slot, next, home;
+
+  slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != index_from_key(key) + 1) {
+    if(hash_index[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  /* Shift later entries of the probe sequence back into the hole, so
+   * that lookups never stop early at an empty slot. */
+  next = slot;
+  while(1) {
+    hash_index[slot] = 0;
+    do {
+      next = (next + 1) % NBR_TABLE_HASH_SIZE;
+      if(hash_index[next] == 0) {
+        return;
+      }
+      home = hash_slot(&key_from_index(hash_index[next] - 1)->lladdr);
+      /* The entry at next can fill the hole at slot unless its home
+       * slot lies cyclically in (slot, next]. */
+    } while(slot <= next ? (slot < home && home <= next)
+                         : (slot < home || home <= next));
+    hash_index[slot] = hash_index[next];
+    slot = next;
+  }
+}
+#endif /* NBR_TABLE_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
   nbr_table_key_t *key;
+#if NBR_TABLE_HASH
+  int slot;
+#endif /* NBR_TABLE_HASH */
+
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  slot = hash_slot(lladdr);
+  while(hash_index[slot] != 0) {
+    key = key_from_index(hash_index[slot] - 1);
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return index_from_key(key);
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -122,6 +208,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -218,6 +305,9 @@ nbr_table_allocate(void)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +388,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
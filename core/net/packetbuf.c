@@ -64,6 +64,10 @@ static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
 static uint8_t *packetbufptr;
 
+/* Called when the packetbuf stops using an external buffer given to
+   packetbuf_attach(). */
+static void (*attached_release)(uint8_t *buf);
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -72,10 +76,36 @@ static uint8_t *packetbufptr;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+detach(void)
+{
+  uint8_t *buf;
+
+  if(packetbuf != (uint8_t *)packetbuf_aligned) {
+    buf = packetbuf;
+    packetbuf = (uint8_t *)packetbuf_aligned;
+    packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+    attached_release(buf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Copy the packet from an attached external buffer into the packetbuf
+   before it is modified. */
+static void
+unshare(void)
+{
+  if(packetbuf != (uint8_t *)packetbuf_aligned) {
+    memcpy((uint8_t *)packetbuf_aligned + hdrptr, packetbuf + hdrptr,
+           PACKETBUF_HDR_SIZE - hdrptr + bufptr + buflen);
+    detach();
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
 {
+  detach();
   buflen = bufptr = 0;
   hdrptr = PACKETBUF_HDR_SIZE;
 
@@ -110,6 +140,7 @@ packetbuf_compact(void)
     memcpy(&packetbuf[PACKETBUF_HDR_SIZE], packetbuf_reference_ptr(),
 	   packetbuf_datalen());
   } else if(bufptr > 0) {
+    unshare();
     len = packetbuf_datalen() + PACKETBUF_HDR_SIZE;
     for(i = PACKETBUF_HDR_SIZE; i < len; i++) {
       packetbuf[i] = packetbuf[bufptr + i];
@@ -206,6 +237,7 @@ packetbuf_set_datalen(uint16_t len)
 void *
 packetbuf_dataptr(void)
 {
+  unshare();
   return (void *)(&packetbuf[bufptr + PACKETBUF_HDR_SIZE]);
 }
 /*---------------------------------------------------------------------------*/
@@ -223,6 +255,16 @@ packetbuf_reference(void *ptr, uint16_t len)
   buflen = len;
 }
 /*---------------------------------------------------------------------------*/
+void
+packetbuf_attach(uint8_t *buf, uint16_t len, void (*release)(uint8_t *buf))
+{
+  packetbuf_clear();
+  packetbuf = buf;
+  packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+  attached_release = release;
+  buflen = len;
+}
+/*---------------------------------------------------------------------------*/
 int
 packetbuf_is_reference(void)
 {
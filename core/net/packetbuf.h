@@ -219,6 +219,26 @@ int packetbuf_is_reference(void);
  */
 void *packetbuf_reference_ptr(void);
 
+/**
+ * \brief      Make the packetbuf use an external buffer without copying it
+ * \param buf  The external buffer
+ * \param len  The length of the data in the external buffer
+ * \param release A function called when the packetbuf stops using
+ *             the external buffer
+ *
+ *             The external buffer is laid out like the packetbuf:
+ *             PACKETBUF_HDR_SIZE bytes of header space followed by
+ *             the data. The packetbuf uses it until the packetbuf is
+ *             cleared or attached to another buffer. Headers may be
+ *             allocated in the header space, but the data is copied
+ *             into the packetbuf before it can be modified through
+ *             packetbuf_dataptr(). Like packetbuf_reference(), the
+ *             function clears the packetbuf first.
+ *
+ */
+void packetbuf_attach(uint8_t *buf, uint16_t len,
+                      void (*release)(uint8_t *buf));
+
 /**
  * \brief      Compact the packetbuf
  *
@@ -333,6 +353,11 @@ struct packetbuf_addr {
 #define PACKETBUF_ATTR_PACKET_TYPE_STREAM_END 3
 #define PACKETBUF_ATTR_PACKET_TYPE_TIMESTAMP 4
 
+/* Transmission priority classes, used by MAC layers that queue
+   packets. Cleared packetbufs are data. */
+#define PACKETBUF_ATTR_PRIORITY_DATA         0
+#define PACKETBUF_ATTR_PRIORITY_CONTROL      1
+
 enum {
   PACKETBUF_ATTR_NONE,
 
@@ -349,6 +374,7 @@ enum {
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
   PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+  PACKETBUF_ATTR_PRIORITY,
   
   /* Scope 1 attributes: used between two neighbors only. */
   PACKETBUF_ATTR_RELIABLE,
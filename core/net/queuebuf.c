@@ -48,6 +48,7 @@
 #endif
 
 #include <string.h> /* for memcpy() */
+#include <stddef.h> /* for offsetof() */
 
 #ifdef QUEUEBUF_CONF_REF_NUM
 #define QUEUEBUF_REF_NUM QUEUEBUF_CONF_REF_NUM
@@ -78,9 +79,17 @@ struct queuebuf {
 /* The actual queuebuf data */
 struct queuebuf_data {
   uint16_t len;
+#if QUEUEBUF_ZEROCOPY
+  /* Header space for when the packetbuf is attached to the data */
+  uint8_t hdr[PACKETBUF_HDR_SIZE];
+#endif /* QUEUEBUF_ZEROCOPY */
   uint8_t data[PACKETBUF_SIZE];
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#if QUEUEBUF_ZEROCOPY
+  /* The queuebuf and the packetbuf may both use the data */
+  uint8_t refs;
+#endif /* QUEUEBUF_ZEROCOPY */
 };
 
 struct queuebuf_ref {
@@ -147,6 +156,24 @@ LIST(queuebuf_list);
 uint8_t queuebuf_len, queuebuf_ref_len, queuebuf_max_len;
 #endif /* QUEUEBUF_STATS */
 
+#if QUEUEBUF_ZEROCOPY
+/*---------------------------------------------------------------------------*/
+static void
+release_data(struct queuebuf_data *d)
+{
+  if(--d->refs == 0) {
+    memb_free(&buframmem, d);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called when the packetbuf stops using queuebuf data */
+static void
+packetbuf_released(uint8_t *hdr)
+{
+  release_data((struct queuebuf_data *)(hdr - offsetof(struct queuebuf_data, hdr)));
+}
+#endif /* QUEUEBUF_ZEROCOPY */
+
 #if WITH_SWAP
 /*---------------------------------------------------------------------------*/
 static void
@@ -342,6 +369,11 @@ queuebuf_new_from_packetbuf(void)
       buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
       buf->ram_ptr = memb_alloc(&buframmem);
+#if QUEUEBUF_ZEROCOPY
+      if(buf->ram_ptr != NULL) {
+        buf->ram_ptr->refs = 1;
+      }
+#endif /* QUEUEBUF_ZEROCOPY */
 #if WITH_SWAP
       /* If the allocation failed, store the qbuf in swap files */
       if(buf->ram_ptr != NULL) {
@@ -408,6 +440,10 @@ void
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+#if QUEUEBUF_ZEROCOPY
+  /* The packetbuf may be attached to the data we overwrite */
+  packetbuf_dataptr();
+#endif /* QUEUEBUF_ZEROCOPY */
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
@@ -427,6 +463,8 @@ queuebuf_free(struct queuebuf *buf)
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
+#elif QUEUEBUF_ZEROCOPY
+    release_data(buf->ram_ptr);
 #else
     memb_free(&buframmem, buf->ram_ptr);
 #endif
@@ -463,6 +501,22 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+queuebuf_attach_to_packetbuf(struct queuebuf *b)
+{
+#if QUEUEBUF_ZEROCOPY
+  struct queuebuf_data *buframptr;
+  if(memb_inmemb(&bufmem, b)) {
+    buframptr = b->ram_ptr;
+    buframptr->refs++;
+    packetbuf_attach(buframptr->hdr, buframptr->len, packetbuf_released);
+    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    return;
+  }
+#endif /* QUEUEBUF_ZEROCOPY */
+  queuebuf_to_packetbuf(b);
+}
+/*---------------------------------------------------------------------------*/
 void *
 queuebuf_dataptr(struct queuebuf *b)
 {
@@ -79,6 +79,16 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* With QUEUEBUF_CONF_ZEROCOPY, queuebuf_attach_to_packetbuf() lets the
+   packetbuf use the queuebuf data in place instead of copying it, at
+   the cost of PACKETBUF_HDR_SIZE more bytes per queuebuf. Not
+   available with swapping. */
+#if defined(QUEUEBUF_CONF_ZEROCOPY) && !WITH_SWAP
+#define QUEUEBUF_ZEROCOPY QUEUEBUF_CONF_ZEROCOPY
+#else /* QUEUEBUF_CONF_ZEROCOPY */
+#define QUEUEBUF_ZEROCOPY 0
+#endif /* QUEUEBUF_CONF_ZEROCOPY */
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -99,6 +109,7 @@ void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 void queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
+void queuebuf_attach_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
@@ -46,8 +46,21 @@
 #include "contiki.h"
 #include "lib/list.h"
 
+#include <stddef.h>
+
+/* Callback timers that were set before ctimer_process started. Once
+   it has started, pending callback timers are only kept by the etimer
+   module. */
 LIST(ctimer_list);
 
+/* Callback timers whose etimers have expired but whose callbacks have
+   not yet been called. The etimer module hands expired timers over
+   with ctimer_expire() instead of posting an event, so that a ctimer
+   that is stopped before its callback is called is removed from this
+   list, and nothing refers to it once its memory is reused. The list
+   is short, since ctimer_process empties it every time it runs. */
+LIST(expired_list);
+
 static char initialized;
 
 #define DEBUG 0
@@ -65,33 +78,44 @@ PROCESS_THREAD(ctimer_process, ev, data)
   struct ctimer *c;
   PROCESS_BEGIN();
 
+  process_set_priority(&ctimer_process, PROCESS_PRIORITY_TIMER);
+
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
+  list_init(ctimer_list);
   initialized = 1;
 
   while(1) {
-    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
-    for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-      if(&c->etimer == data) {
-	list_remove(ctimer_list, c);
-	PROCESS_CONTEXT_BEGIN(c->p);
-	if(c->f != NULL) {
-	  c->f(c->ptr);
-	}
-	PROCESS_CONTEXT_END(c->p);
-	break;
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while((c = list_pop(expired_list)) != NULL) {
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
       }
+      PROCESS_CONTEXT_END(c->p);
     }
   }
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
 void
+ctimer_expire(struct etimer *et)
+{
+  struct ctimer *c;
+
+  c = (struct ctimer *)((char *)et - offsetof(struct ctimer, etimer));
+  list_add(expired_list, c);
+  process_poll(&ctimer_process);
+}
+/*---------------------------------------------------------------------------*/
+void
 ctimer_init(void)
 {
   initialized = 0;
   list_init(ctimer_list);
+  list_init(expired_list);
   process_start(&ctimer_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -104,41 +128,43 @@ ctimer_set(struct ctimer *c, clock_time_t t,
   c->f = f;
   c->ptr = ptr;
   if(initialized) {
+    list_remove(expired_list, c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_set(&c->etimer, t);
     PROCESS_CONTEXT_END(&ctimer_process);
   } else {
     c->etimer.timer.interval = t;
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
   if(initialized) {
+    list_remove(expired_list, c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_reset(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_restart(struct ctimer *c)
 {
   if(initialized) {
+    list_remove(expired_list, c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_restart(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -146,11 +172,12 @@ ctimer_stop(struct ctimer *c)
 {
   if(initialized) {
     etimer_stop(&c->etimer);
+    list_remove(expired_list, c);
   } else {
     c->etimer.next = NULL;
     c->etimer.p = PROCESS_NONE;
+    list_remove(ctimer_list, c);
   }
-  list_remove(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 int
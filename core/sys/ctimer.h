@@ -135,6 +135,18 @@ void ctimer_stop(struct ctimer *c);
  */
 int ctimer_expired(struct ctimer *c);
 
+/**
+ * \brief      Hand an expired etimer over to the callback timer library.
+ * \param et   A pointer to the etimer embedded in a callback timer.
+ *
+ *             This function is called by the etimer library when the
+ *             etimer of a callback timer expires, instead of posting
+ *             an event. It is not meant to be called by applications.
+ */
+void ctimer_expire(struct etimer *et);
+
+PROCESS_NAME(ctimer_process);
+
 /**
  * \brief      Initialize the callback timer library.
  *
@@ -47,8 +47,408 @@
 #include "contiki-conf.h"
 
 #include "sys/etimer.h"
+#include "sys/ctimer.h"
 #include "sys/process.h"
 
+/*---------------------------------------------------------------------------*/
+/* Tell the process that owns an expired timer. The etimers embedded
+   in callback timers are handed to the ctimer library directly rather
+   than through an event, since the callback timer may be stopped and
+   its memory reused before the event would be delivered. */
+static int
+post_timer(struct etimer *t)
+{
+  if(t->p == &ctimer_process) {
+    ctimer_expire(t);
+    return PROCESS_ERR_OK;
+  }
+  return process_post(t->p, PROCESS_EVENT_TIMER, t);
+}
+
+#if ETIMER_WHEEL
+
+#define WHEEL_SLOTS  (1 << ETIMER_WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_SHIFT(level) (ETIMER_WHEEL_BITS * (level))
+#define WHEEL_RANGE  ((unsigned long)1 << WHEEL_SHIFT(ETIMER_WHEEL_LEVELS))
+#define WHEEL_INDEX(time, level) \
+  (((unsigned long)(time) >> WHEEL_SHIFT(level)) & WHEEL_MASK)
+
+#if ETIMER_WHEEL_BITS < 3 || ETIMER_WHEEL_BITS > 12 || \
+    ETIMER_WHEEL_LEVELS < 2 || WHEEL_SHIFT(ETIMER_WHEEL_LEVELS) >= 32
+#error ETIMER_CONF_WHEEL_BITS and ETIMER_CONF_WHEEL_LEVELS out of range
+#endif
+
+/*
+ * The timing wheel. Level 0 has one slot per clock tick; each slot
+ * in level n covers 2^(ETIMER_WHEEL_BITS * n) ticks. Each slot is a
+ * list threaded through the next fields of the etimers, and each
+ * etimer records the slot it is on, so that unlinking a timer only
+ * searches the timers that share its slot. The occupied bitmaps may
+ * have stale bits set for slots that have become empty; they are
+ * cleared lazily when the slot is scanned.
+ */
+static struct etimer *wheel[ETIMER_WHEEL_LEVELS][WHEEL_SLOTS];
+static uint8_t occupied[ETIMER_WHEEL_LEVELS][WHEEL_SLOTS / 8];
+
+/* Timers that have expired but for which the event has not yet been
+   posted to the process. */
+static struct etimer *overdue;
+
+/* The slot number that etimers on the overdue list record. Slots in
+   the wheel are numbered level * WHEEL_SLOTS + index. */
+#define OVERDUE_SLOT (ETIMER_WHEEL_LEVELS * WHEEL_SLOTS)
+
+/* The next clock tick that the wheel has not yet processed. */
+static clock_time_t wheel_time;
+
+static unsigned int pending_timers;
+static clock_time_t next_expiration;
+static uint8_t next_expiration_valid;
+
+PROCESS(etimer_process, "Event timer");
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+expiration(struct etimer *t)
+{
+  return t->timer.start + t->timer.interval;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer **
+slot_head(unsigned int slot)
+{
+  if(slot == OVERDUE_SLOT) {
+    return &overdue;
+  }
+  return &wheel[slot / WHEEL_SLOTS][slot % WHEEL_SLOTS];
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_timer(unsigned int slot, struct etimer *t)
+{
+  struct etimer **head = slot_head(slot);
+
+  t->slot = slot;
+  t->next = *head;
+  *head = t;
+}
+/*---------------------------------------------------------------------------*/
+/* Unlink a timer from the slot that it records. Nothing in the timer
+   is trusted, since it may never have been set before: it is only
+   unlinked if it is found on that slot. Returns non-zero if the timer
+   was found. */
+static int
+unlink_timer(struct etimer *t)
+{
+  struct etimer **pp;
+
+  if(t->slot > OVERDUE_SLOT) {
+    return 0;
+  }
+  for(pp = slot_head(t->slot); *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == t) {
+      *pp = t->next;
+      t->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+unlink_head(struct etimer **head)
+{
+  struct etimer *t = *head;
+
+  if(t != NULL) {
+    *head = t->next;
+    t->next = NULL;
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+/* Return the first non-empty slot at or after from in the given
+   level, or WHEEL_SLOTS if there is none. */
+static int
+next_slot(int level, int from)
+{
+  while(from < WHEEL_SLOTS) {
+    if(occupied[level][from >> 3] == 0) {
+      from = (from | 7) + 1;
+    } else if(occupied[level][from >> 3] & (1 << (from & 7))) {
+      if(wheel[level][from] != NULL) {
+        return from;
+      }
+      occupied[level][from >> 3] &= ~(1 << (from & 7));
+      from++;
+    } else {
+      from++;
+    }
+  }
+  return WHEEL_SLOTS;
+}
+/*---------------------------------------------------------------------------*/
+/* Put a timer into the wheel slot that corresponds to its expiration
+   time, or onto the overdue list if it has already expired. Returns
+   non-zero if the timer was put into the wheel. */
+static int
+place_timer(struct etimer *t)
+{
+  clock_time_t expires;
+  unsigned long distance;
+  int level, slot;
+
+  if(timer_expired(&t->timer)) {
+    link_timer(OVERDUE_SLOT, t);
+    return 0;
+  }
+
+  expires = expiration(t);
+  distance = (clock_time_t)(expires - wheel_time);
+  for(level = 0; level < ETIMER_WHEEL_LEVELS - 1; level++) {
+    if(distance < ((unsigned long)1 << WHEEL_SHIFT(level + 1))) {
+      break;
+    }
+  }
+  if(distance >= WHEEL_RANGE) {
+    /* Too far into the future: park the timer in the last slot that
+       the wheel can represent. It is re-placed when that slot is
+       cascaded. */
+    expires = wheel_time + (clock_time_t)(WHEEL_RANGE - 1);
+  }
+
+  slot = WHEEL_INDEX(expires, level);
+  link_timer(level * WHEEL_SLOTS + slot, t);
+  occupied[level][slot >> 3] |= 1 << (slot & 7);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Re-place all timers in the current slot of the given level into
+   the lower levels. */
+static void
+cascade(int level)
+{
+  struct etimer *t;
+  int slot;
+
+  slot = WHEEL_INDEX(wheel_time, level);
+  if(slot == 0 && level + 1 < ETIMER_WHEEL_LEVELS) {
+    cascade(level + 1);
+  }
+
+  while((t = unlink_head(&wheel[level][slot])) != NULL) {
+    place_timer(t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find the earliest expiration time of the timers in the wheel. The
+   result is cached in next_expiration, since etimer_pending() and
+   etimer_next_expiration_time() may be called from interrupt
+   context. */
+static void
+update_time(void)
+{
+  struct etimer *t;
+  clock_time_t distance, best, lower;
+  int level, slot, current, found;
+
+  found = 0;
+  best = 0;
+  for(level = 0; level < ETIMER_WHEEL_LEVELS; level++) {
+    if(level > 0) {
+      /* All timers at this level expire after the end of the current
+         slot of the level. */
+      lower = (((((unsigned long)wheel_time >> WHEEL_SHIFT(level)) + 1)
+                << WHEEL_SHIFT(level)) - wheel_time);
+      if(found && best <= lower) {
+        break;
+      }
+    }
+
+    /* The current slot of a higher level has already been cascaded,
+       and can only hold timers for the next rotation of the level. */
+    current = WHEEL_INDEX(wheel_time, level);
+    slot = next_slot(level, level == 0 ? current : current + 1);
+    if(slot == WHEEL_SLOTS) {
+      slot = next_slot(level, 0);
+    }
+    if(slot == WHEEL_SLOTS) {
+      continue;
+    }
+
+    if(level == 0) {
+      /* All timers in a level 0 slot expire on the same tick. */
+      distance = (slot - current) & WHEEL_MASK;
+      if(!found || distance < best) {
+        best = distance;
+        found = 1;
+      }
+      continue;
+    }
+
+    /* Slots are ordered by time, starting after the current one, so
+       only the first non-empty slot needs to be searched. Timers in
+       the last level may have been parked in any slot, so all of
+       its slots are searched. */
+    if(level == ETIMER_WHEEL_LEVELS - 1) {
+      slot = next_slot(level, 0);
+    }
+    for(; slot < WHEEL_SLOTS; slot = next_slot(level, slot + 1)) {
+      for(t = wheel[level][slot]; t != NULL; t = t->next) {
+        distance = expiration(t) - wheel_time;
+        if(!found || distance < best) {
+          best = distance;
+          found = 1;
+        }
+      }
+      if(level < ETIMER_WHEEL_LEVELS - 1) {
+        break;
+      }
+    }
+  }
+
+  next_expiration = wheel_time + best;
+  next_expiration_valid = found;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *t)
+{
+  if(pending_timers == 0) {
+    /* The wheel is empty, so it can skip ahead to the current time. */
+    wheel_time = clock_time() + 1;
+  }
+  pending_timers++;
+
+  if(place_timer(t)) {
+    if(!next_expiration_valid ||
+       (clock_time_t)(expiration(t) - wheel_time) <
+       (clock_time_t)(next_expiration - wheel_time)) {
+      next_expiration = expiration(t);
+      next_expiration_valid = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a timer from the wheel if it is pending. This must be done
+   before the timer is modified, since the cached next expiration time
+   is refreshed only if the timer's expiration time matches it.
+   Returns non-zero if the timer was pending. */
+static int
+remove_timer(struct etimer *t)
+{
+  if(t->p == PROCESS_NONE || !unlink_timer(t)) {
+    return 0;
+  }
+  pending_timers--;
+  if(next_expiration_valid && expiration(t) == next_expiration) {
+    update_time();
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct process *p, struct etimer **head)
+{
+  struct etimer **pp;
+
+  for(pp = head; *pp != NULL;) {
+    if((*pp)->p == p) {
+      unlink_head(pp);
+      pending_timers--;
+    } else {
+      pp = &(*pp)->next;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_wheel(void)
+{
+  struct etimer *t;
+  clock_time_t now, left;
+  int slot, next;
+
+  now = clock_time();
+
+  /* Move all timers that expire up to and including now onto the
+     overdue list. Empty slots are skipped using the bitmap, stopping
+     at every wrap of level 0 to cascade the higher levels. */
+  while(pending_timers > 0 && wheel_time != (clock_time_t)(now + 1)) {
+    slot = wheel_time & WHEEL_MASK;
+
+    while((t = unlink_head(&wheel[0][slot])) != NULL) {
+      if(timer_expired(&t->timer)) {
+        link_timer(OVERDUE_SLOT, t);
+      } else {
+        /* The timer was modified behind our back. */
+        place_timer(t);
+      }
+    }
+
+    next = next_slot(0, slot + 1);
+    left = now + 1 - wheel_time;
+    if(left <= (clock_time_t)(next - slot)) {
+      wheel_time = now + 1;
+    } else {
+      wheel_time += next - slot;
+    }
+    if((wheel_time & WHEEL_MASK) == 0) {
+      cascade(1);
+    }
+  }
+  if(pending_timers == 0) {
+    wheel_time = now + 1;
+  }
+
+  while((t = overdue) != NULL) {
+    if(post_timer(t) != PROCESS_ERR_OK) {
+      etimer_request_poll();
+      break;
+    }
+    /* Reset the process ID of the event timer, to signal that the
+       etimer has expired. This is later checked in the
+       etimer_expired() function. */
+    t->p = PROCESS_NONE;
+    unlink_head(&overdue);
+    pending_timers--;
+  }
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  int level, slot;
+
+  PROCESS_BEGIN();
+
+  process_set_priority(&etimer_process, PROCESS_PRIORITY_TIMER);
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      struct process *p = data;
+
+      remove_process_timers(p, &overdue);
+      for(level = 0; level < ETIMER_WHEEL_LEVELS; level++) {
+        for(slot = next_slot(level, 0); slot < WHEEL_SLOTS;
+            slot = next_slot(level, slot + 1)) {
+          remove_process_timers(p, &wheel[level][slot]);
+        }
+      }
+      update_time();
+    } else if(ev == PROCESS_EVENT_POLL) {
+      run_wheel();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_WHEEL */
+
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
@@ -83,6 +483,8 @@ PROCESS_THREAD(etimer_process, ev, data)
 	
   PROCESS_BEGIN();
 
+  process_set_priority(&etimer_process, PROCESS_PRIORITY_TIMER);
+
   timerlist = NULL;
   
   while(1) {
@@ -115,7 +517,7 @@ PROCESS_THREAD(etimer_process, ev, data)
     
     for(t = timerlist; t != NULL; t = t->next) {
       if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+	if(post_timer(t) == PROCESS_ERR_OK) {
 	  
 	  /* Reset the process ID of the event timer, to signal that the
 	     etimer has expired. This is later checked in the
@@ -141,12 +543,26 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#endif /* ETIMER_WHEEL */
+/*---------------------------------------------------------------------------*/
 void
 etimer_request_poll(void)
 {
   process_poll(&etimer_process);
 }
 /*---------------------------------------------------------------------------*/
+#if ETIMER_WHEEL
+/* The timer has been removed from the wheel with remove_timer()
+   before its expiration time was changed. */
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  timer->p = PROCESS_CURRENT();
+  insert_timer(timer);
+}
+#else /* ETIMER_WHEEL */
 static void
 add_timer(struct etimer *timer)
 {
@@ -172,10 +588,14 @@ add_timer(struct etimer *timer)
 
   update_time();
 }
+#endif /* ETIMER_WHEEL */
 /*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
 {
+#if ETIMER_WHEEL
+  remove_timer(et);
+#endif /* ETIMER_WHEEL */
   timer_set(&et->timer, interval);
   add_timer(et);
 }
@@ -183,6 +603,9 @@ etimer_set(struct etimer *et, clock_time_t interval)
 void
 etimer_reset(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  remove_timer(et);
+#endif /* ETIMER_WHEEL */
   timer_reset(&et->timer);
   add_timer(et);
 }
@@ -190,6 +613,9 @@ etimer_reset(struct etimer *et)
 void
 etimer_restart(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  remove_timer(et);
+#endif /* ETIMER_WHEEL */
   timer_restart(&et->timer);
   add_timer(et);
 }
@@ -197,6 +623,13 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_WHEEL
+  if(remove_timer(et)) {
+    et->timer.start += timediff;
+    insert_timer(et);
+    return;
+  }
+#endif /* ETIMER_WHEEL */
   et->timer.start += timediff;
   update_time();
 }
@@ -222,18 +655,37 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_WHEEL
+  return pending_timers > 0;
+#else /* ETIMER_WHEEL */
   return timerlist != NULL;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
 etimer_next_expiration_time(void)
 {
+#if ETIMER_WHEEL
+  if(!etimer_pending()) {
+    return 0;
+  }
+  if(overdue != NULL || !next_expiration_valid) {
+    /* Some timer has already expired. */
+    return clock_time();
+  }
+  return next_expiration;
+#else /* ETIMER_WHEEL */
   return etimer_pending() ? next_expiration : 0;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  remove_timer(et);
+  et->p = PROCESS_NONE;
+#else /* ETIMER_WHEEL */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -259,6 +711,7 @@ etimer_stop(struct etimer *et)
   et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
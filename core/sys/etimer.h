@@ -65,6 +65,47 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * \brief Select the timing-wheel event timer backend.
+ *
+ *        By default, all pending event timers are kept on a single
+ *        unsorted list, which makes setting, stopping and expiring
+ *        a timer linear in the number of pending timers. Setting
+ *        ETIMER_CONF_WHEEL to 1 keeps the timers in a hierarchical
+ *        timing wheel instead, where setting and stopping a timer
+ *        only searches the timers that expire in the same slot of
+ *        the wheel. This is intended for systems with many
+ *        concurrent timers, such as border routers and native
+ *        gateways.
+ */
+#ifdef ETIMER_CONF_WHEEL
+#define ETIMER_WHEEL ETIMER_CONF_WHEEL
+#else /* ETIMER_CONF_WHEEL */
+#define ETIMER_WHEEL 0
+#endif /* ETIMER_CONF_WHEEL */
+
+/**
+ * The number of slots in each level of the timing wheel, expressed
+ * as a power of two, from 3 to 12.
+ */
+#ifdef ETIMER_CONF_WHEEL_BITS
+#define ETIMER_WHEEL_BITS ETIMER_CONF_WHEEL_BITS
+#else /* ETIMER_CONF_WHEEL_BITS */
+#define ETIMER_WHEEL_BITS 6
+#endif /* ETIMER_CONF_WHEEL_BITS */
+
+/**
+ * The number of levels in the timing wheel, at least two. Timers
+ * further than 2^(ETIMER_WHEEL_BITS * ETIMER_WHEEL_LEVELS) ticks into
+ * the future are kept in the last level and cascaded down as time
+ * passes.
+ */
+#ifdef ETIMER_CONF_WHEEL_LEVELS
+#define ETIMER_WHEEL_LEVELS ETIMER_CONF_WHEEL_LEVELS
+#else /* ETIMER_CONF_WHEEL_LEVELS */
+#define ETIMER_WHEEL_LEVELS 4
+#endif /* ETIMER_CONF_WHEEL_LEVELS */
+
 /**
  * A timer.
  *
@@ -76,6 +117,9 @@
 struct etimer {
   struct timer timer;
   struct etimer *next;
+#if ETIMER_WHEEL
+  uint16_t slot;
+#endif /* ETIMER_WHEEL */
   struct process *p;
 };
 
@@ -47,6 +47,7 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#include "lib/list.h"
 
 /*
  * Pointer to the currently running process structure.
@@ -65,13 +66,37 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * One event queue for each priority. Without priorities, there is
+ * just one queue.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  struct event_data events[PROCESS_CONF_NUMEVENTS];
+};
+
+static struct event_queue queues[PROCESS_PRIORITIES];
+
+/* The total number of events in all queues. */
+static unsigned int nevents;
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+process_num_events_t process_queue_maxevents[PROCESS_PRIORITIES];
+unsigned long process_droppedevents;
 #endif
 
+#if PROCESS_PRIORITIES > 1
+#define PRIORITY(p) ((p) == PROCESS_BROADCAST ? PROCESS_PRIORITY_APP : \
+                     (p)->priority)
+#else /* PROCESS_PRIORITIES > 1 */
+#define PRIORITY(p) 0
+#endif /* PROCESS_PRIORITIES > 1 */
+
+#if PROCESS_SUBSCRIPTIONS
+LIST(subscriptions);
+#endif /* PROCESS_SUBSCRIPTIONS */
+
 static volatile unsigned char poll_requested;
 
 #define PROCESS_STATE_NONE        0
@@ -157,6 +182,19 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_SUBSCRIPTIONS
+  if(p->subscriptions > 0) {
+    struct process_subscription *s, *next;
+
+    for(s = list_head(subscriptions); s != NULL; s = next) {
+      next = s->next;
+      if(s->p == p) {
+        process_unsubscribe(s);
+      }
+    }
+  }
+#endif /* PROCESS_SUBSCRIPTIONS */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -207,13 +245,26 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+#if PROCESS_CONF_STATS
+    process_queue_maxevents[i] = 0;
+#endif /* PROCESS_CONF_STATS */
+  }
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_droppedevents = 0;
 #endif /* PROCESS_CONF_STATS */
 
+#if PROCESS_SUBSCRIPTIONS
+  list_init(subscriptions);
+#endif /* PROCESS_SUBSCRIPTIONS */
+
   process_current = process_list = NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -237,6 +288,46 @@ do_poll(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Deliver a broadcast event to all processes. With subscriptions,
+ * processes that have subscribed to some events only receive those.
+ */
+static void
+do_broadcast(process_event_t ev, process_data_t data)
+{
+  static struct process *p;
+#if PROCESS_SUBSCRIPTIONS
+  static struct process_subscription *s, *next;
+#endif /* PROCESS_SUBSCRIPTIONS */
+
+  for(p = process_list; p != NULL; p = p->next) {
+#if PROCESS_SUBSCRIPTIONS
+    if(p->subscriptions > 0) {
+      continue;
+    }
+#endif /* PROCESS_SUBSCRIPTIONS */
+
+    /* If we have been requested to poll a process, we do this in
+       between processing the broadcast event. */
+    if(poll_requested) {
+      do_poll();
+    }
+    call_process(p, ev, data);
+  }
+
+#if PROCESS_SUBSCRIPTIONS
+  for(s = list_head(subscriptions); s != NULL; s = next) {
+    next = s->next;
+    if(s->ev == ev) {
+      if(poll_requested) {
+	do_poll();
+      }
+      call_process(s->p, ev, data);
+    }
+  }
+#endif /* PROCESS_SUBSCRIPTIONS */
+}
+/*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
@@ -248,7 +339,7 @@ do_event(void)
   static process_event_t ev;
   static process_data_t data;
   static struct process *receiver;
-  static struct process *p;
+  static struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,30 +350,29 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* Take the event from the highest priority queue that is not
+       empty. */
+    q = &queues[PROCESS_PRIORITIES - 1];
+    while(q->nevents == 0) {
+      q--;
+    }
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    --q->nevents;
     --nevents;
 
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
+    /* If this is a broadcast event, we deliver it to all events. */
     if(receiver == PROCESS_BROADCAST) {
-      for(p = process_list; p != NULL; p = p->next) {
-
-	/* If we have been requested to poll a process, we do this in
-	   between processing the broadcast event. */
-	if(poll_requested) {
-	  do_poll();
-	}
-	call_process(p, ev, data);
-      }
+      do_broadcast(ev, data);
     } else {
       /* This is not a broadcast event, so we deliver it to the
 	 specified process. */
@@ -322,6 +412,7 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+  static struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +423,12 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  q = &queues[PRIORITY(p)];
+
+  if(q->nevents == PROCESS_CONF_NUMEVENTS) {
+#if PROCESS_CONF_STATS
+    process_droppedevents++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,16 +439,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_NUMEVENTS;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
   if(nevents > process_maxevents) {
     process_maxevents = nevents;
   }
+  if(q->nevents > process_queue_maxevents[PRIORITY(p)]) {
+    process_queue_maxevents[PRIORITY(p)] = q->nevents;
+  }
 #endif /* PROCESS_CONF_STATS */
   
   return PROCESS_ERR_OK;
@@ -385,4 +485,41 @@ process_is_running(struct process *p)
   return p->state != PROCESS_STATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITIES > 1
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  if(priority >= PROCESS_PRIORITIES) {
+    priority = PROCESS_PRIORITIES - 1;
+  }
+  p->priority = priority;
+}
+#endif /* PROCESS_PRIORITIES > 1 */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_SUBSCRIPTIONS
+void
+process_subscribe(struct process_subscription *s,
+                  struct process *p, process_event_t ev)
+{
+  s->p = p;
+  s->ev = ev;
+  list_add(subscriptions, s);
+  p->subscriptions++;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+  struct process_subscription *t;
+
+  for(t = list_head(subscriptions); t != NULL; t = t->next) {
+    if(t == s) {
+      list_remove(subscriptions, s);
+      s->p->subscriptions--;
+      return;
+    }
+  }
+}
+#endif /* PROCESS_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
 /** @} */
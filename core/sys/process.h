@@ -88,6 +88,38 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priorities
+ *
+ * With PROCESS_CONF_PRIORITIES set to more than 1, there is one event
+ * queue of PROCESS_CONF_NUMEVENTS entries for each priority. Events
+ * are queued according to the priority of the receiving process, and
+ * events with a higher priority are always delivered first, so that
+ * network and timer events do not have to wait behind application
+ * events. Broadcast events have application priority.
+ *
+ * @{
+ */
+#ifdef PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIORITIES PROCESS_CONF_PRIORITIES
+#else /* PROCESS_CONF_PRIORITIES */
+#define PROCESS_PRIORITIES 1
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#define PROCESS_PRIORITY_APP     0
+#define PROCESS_PRIORITY_TIMER   1
+#define PROCESS_PRIORITY_NETWORK 2
+/** @} */
+
+/**
+ * Enable broadcast event subscriptions, see process_subscribe().
+ */
+#ifdef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_SUBSCRIPTIONS PROCESS_CONF_SUBSCRIPTIONS
+#else /* PROCESS_CONF_SUBSCRIPTIONS */
+#define PROCESS_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,7 +355,27 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_PRIORITIES > 1
+  unsigned char priority;
+#endif /* PROCESS_PRIORITIES > 1 */
+#if PROCESS_SUBSCRIPTIONS
+  unsigned char subscriptions;
+#endif /* PROCESS_SUBSCRIPTIONS */
+};
+
+#if PROCESS_SUBSCRIPTIONS
+/**
+ * A subscription of a process to a broadcast event.
+ *
+ * This structure is owned by the subscribing process and must stay
+ * allocated while the subscription is active.
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
 };
+#endif /* PROCESS_SUBSCRIPTIONS */
 
 /**
  * \name Functions called from application programs
@@ -452,6 +504,44 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_PRIORITIES > 1
+/**
+ * \brief      Set the priority of a process
+ * \param p    The process
+ * \param priority The priority, e.g. PROCESS_PRIORITY_NETWORK
+ *
+ *             Events posted to the process after this call are
+ *             queued with the given priority. Priorities above
+ *             PROCESS_PRIORITIES - 1 are lowered to that value.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+#else /* PROCESS_PRIORITIES > 1 */
+#define process_set_priority(p, priority)
+#endif /* PROCESS_PRIORITIES > 1 */
+
+#if PROCESS_SUBSCRIPTIONS
+/**
+ * \brief      Subscribe a process to a broadcast event
+ * \param s    A subscription structure owned by the caller
+ * \param p    The process
+ * \param ev   The event
+ *
+ *             By default, all processes receive all broadcast
+ *             events. Once a process has subscribed to at least one
+ *             event, it only receives the broadcast events that it
+ *             has subscribed to. Events posted directly to the
+ *             process are not affected.
+ */
+void process_subscribe(struct process_subscription *s,
+                       struct process *p, process_event_t ev);
+
+/**
+ * \brief      Remove a subscription made with process_subscribe()
+ * \param s    The subscription
+ */
+void process_unsubscribe(struct process_subscription *s);
+#endif /* PROCESS_SUBSCRIPTIONS */
+
 /** @} */
 
 /**
@@ -521,6 +611,22 @@ int process_nevents(void);
 
 /** @} */
 
+#if PROCESS_CONF_STATS
+/**
+ * \name Event queue statistics
+ * @{
+ */
+/** The highest number of events that have been waiting at any time. */
+extern process_num_events_t process_maxevents;
+/** The highest number of events that have been waiting in each
+    priority queue. */
+extern process_num_events_t process_queue_maxevents[PROCESS_PRIORITIES];
+/** The number of events that could not be posted because the event
+    queue was full. */
+extern unsigned long process_droppedevents;
+/** @} */
+#endif /* PROCESS_CONF_STATS */
+
 CCIF extern struct process *process_list;
 
 #define PROCESS_LIST() process_list
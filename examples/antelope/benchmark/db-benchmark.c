@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A benchmark of selective queries over a large relation.
+ *
+ *	The benchmark fills a relation with BENCHMARK_ROWS tuples and
+ *	times a query whose predicate matches only a few of them, so
+ *	that the time is spent scanning rows and evaluating the
+ *	predicate. It is meant to be run on the native platform.
+ */
+
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+#ifndef BENCHMARK_ROWS
+#define BENCHMARK_ROWS		100000UL
+#endif
+
+#ifndef BENCHMARK_RUNS
+#define BENCHMARK_RUNS		5
+#endif
+
+#define BENCHMARK_QUERY \
+  "SELECT id, value FROM samples WHERE value = 7 AND id > 50000;"
+
+PROCESS(db_benchmark, "DB benchmark");
+AUTOSTART_PROCESSES(&db_benchmark);
+
+static db_result_t
+run_query(db_handle_t *handle, const char *query, unsigned long *matching)
+{
+  db_result_t result;
+
+  *matching = 0;
+
+  result = db_query(handle, query);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else if(DB_ERROR(result)) {
+      break;
+    }
+  }
+
+  db_free(handle);
+
+  return DB_ERROR(result) ? result : DB_OK;
+}
+
+PROCESS_THREAD(db_benchmark, ev, data)
+{
+  static db_handle_t handle;
+  static unsigned long i;
+  static int run;
+  db_result_t result;
+  unsigned long matching;
+  clock_time_t start;
+  clock_time_t elapsed;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  db_query(&handle, "REMOVE RELATION samples;");
+  if(DB_ERROR(db_query(&handle, "CREATE RELATION samples;")) ||
+     DB_ERROR(db_query(&handle, "CREATE ATTRIBUTE id DOMAIN LONG IN samples;")) ||
+     DB_ERROR(db_query(&handle, "CREATE ATTRIBUTE value DOMAIN INT IN samples;"))) {
+    printf("Failed to create the relation\n");
+    PROCESS_EXIT();
+  }
+
+  printf("Inserting %lu rows...\n", BENCHMARK_ROWS);
+  for(i = 0; i < BENCHMARK_ROWS; i++) {
+    result = db_query(&handle, "INSERT (%lu, %lu) INTO samples;", i, i % 1000);
+    if(DB_ERROR(result)) {
+      printf("Insert failed: %s\n", db_get_result_message(result));
+      PROCESS_EXIT();
+    }
+    if((i & 0xfff) == 0) {
+      PROCESS_PAUSE();
+    }
+  }
+
+  printf("Query: %s\n", BENCHMARK_QUERY);
+  for(run = 0; run < BENCHMARK_RUNS; run++) {
+    start = clock_time();
+    result = run_query(&handle, BENCHMARK_QUERY, &matching);
+    elapsed = clock_time() - start;
+    if(DB_ERROR(result)) {
+      printf("Query failed: %s\n", db_get_result_message(result));
+      PROCESS_EXIT();
+    }
+
+    printf("Run %d: %lu of %lu rows matched in %lu ms\n", run + 1,
+           matching, BENCHMARK_ROWS,
+           (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+    PROCESS_PAUSE();
+  }
+
+  db_query(&handle, "REMOVE RELATION samples;");
+
+  PROCESS_END();
+}
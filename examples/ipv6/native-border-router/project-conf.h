@@ -49,6 +49,17 @@
 
 #define SERIALIZE_ATTRIBUTES 1
 
+#define ETIMER_CONF_WHEEL 1
+#define PROCESS_CONF_PRIORITIES 3
+#define MEMB_CONF_FREELIST 1
+#define NBR_TABLE_CONF_HASH 1
+#define UIP_DS6_ROUTE_CONF_HASH 1
+#define UIP_DS6_NBR_CONF_HASH 1
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 4
+#define SICSLOWPAN_CONF_FRAG_FORWARDING 4
+#define QUEUEBUF_CONF_ZEROCOPY 1
+#define UIP_CONF_CONN_HASH_SIZE 16
+
 #define CMD_CONF_OUTPUT border_router_cmd_output
 
 #undef NETSTACK_CONF_RDC
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark for the managed memory allocator. It replays
+ *         two reproducible traces, first checking that no block is
+ *         corrupted and then measuring the time each trace takes. The
+ *         mixed trace allocates and frees blocks of mixed sizes. The
+ *         fragmenting trace fills the memory, frees every other block
+ *         and then allocates blocks that only fit once the memory has
+ *         been compacted, so that both allocators have to compact.
+ *         An allocation that fails is retried after mmem_compact().
+ */
+
+#include "contiki.h"
+#include "lib/mmem.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SLOTS       256
+#define TRACE_OPS   2000
+#define ROUNDS      200
+#define MIN_SIZE    8
+#define MAX_SIZE    120
+
+/* SLOTS blocks of SMALL_SIZE bytes fill the MMEM_CONF_SIZE set in the
+   Makefile. LARGE_SIZE is larger than the gap left by two freed small
+   blocks. */
+#define SMALL_SIZE  64
+#define LARGE_SIZE  (4 * SMALL_SIZE)
+
+static struct mmem blocks[SLOTS];
+static unsigned char allocated[SLOTS];
+static unsigned char fill[SLOTS];
+static unsigned long seed;
+/*---------------------------------------------------------------------------*/
+static unsigned int
+next_random(void)
+{
+  /* A private generator, so that the trace is the same on every
+     platform and in every round. */
+  seed = seed * 1103515245UL + 12345UL;
+  return (unsigned int)(seed >> 16) & 0x7fff;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_blocks(void)
+{
+  unsigned char *p;
+  int i;
+  unsigned int j;
+
+  for(i = 0; i < SLOTS; i++) {
+    if(allocated[i]) {
+      p = (unsigned char *)MMEM_PTR(&blocks[i]);
+      for(j = 0; j < blocks[i].size; j++) {
+        if(p[j] != fill[i]) {
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+alloc_block(int i, unsigned int size, unsigned char value, int check)
+{
+  if(!mmem_alloc(&blocks[i], size)) {
+    /* mmem_alloc() does not move blocks, so make room by compacting
+       the whole memory and try once more. */
+    mmem_compact(MMEM_CONF_SIZE);
+    if(!mmem_alloc(&blocks[i], size)) {
+      return 0;
+    }
+  }
+  allocated[i] = 1;
+  fill[i] = value;
+  if(check) {
+    memset(MMEM_PTR(&blocks[i]), fill[i], size);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_all(void)
+{
+  int i;
+
+  for(i = 0; i < SLOTS; i++) {
+    if(allocated[i]) {
+      mmem_free(&blocks[i]);
+      allocated[i] = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+replay(int check)
+{
+  unsigned int size;
+  int i, op;
+
+  mmem_init();
+  memset(allocated, 0, sizeof(allocated));
+  seed = 1;
+
+  for(op = 0; op < TRACE_OPS; op++) {
+    i = next_random() % SLOTS;
+    if(allocated[i]) {
+      mmem_free(&blocks[i]);
+      allocated[i] = 0;
+    } else {
+      /* Mostly small blocks, with an occasional large one. */
+      size = MIN_SIZE + next_random() % 32;
+      if(next_random() % 8 == 0) {
+        size = MIN_SIZE + next_random() % (MAX_SIZE - MIN_SIZE);
+      }
+      alloc_block(i, size, (unsigned char)op, check);
+    }
+    if(check && !check_blocks()) {
+      printf("mmem-benchmark: corrupted block after operation %d\n", op);
+      return 0;
+    }
+  }
+
+  free_all();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fragment(int check)
+{
+  int i, large;
+
+  mmem_init();
+  memset(allocated, 0, sizeof(allocated));
+
+  /* Fill the memory with small blocks. */
+  for(i = 0; i < SLOTS; i++) {
+    if(!alloc_block(i, SMALL_SIZE, (unsigned char)i, check)) {
+      break;
+    }
+  }
+
+  /* Free every other block, which leaves the free memory in gaps that
+     are too small for a large block. */
+  for(i = 0; i < SLOTS; i += 2) {
+    if(allocated[i]) {
+      mmem_free(&blocks[i]);
+      allocated[i] = 0;
+    }
+    if(check && !check_blocks()) {
+      printf("mmem-benchmark: corrupted block after freeing %d\n", i);
+      return 0;
+    }
+  }
+
+  /* Allocate large blocks until the memory is full again. */
+  large = 0;
+  for(i = 0; i < SLOTS; i += 2) {
+    if(!alloc_block(i, LARGE_SIZE, (unsigned char)~i, check)) {
+      break;
+    }
+    large++;
+    if(check && !check_blocks()) {
+      printf("mmem-benchmark: corrupted block after allocating %d\n", i);
+      return 0;
+    }
+  }
+  if(large == 0) {
+    printf("mmem-benchmark: no large block could be allocated\n");
+    return 0;
+  }
+
+  free_all();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+measure(const char *name, int (*trace)(int))
+{
+  clock_time_t start;
+  int round;
+
+  memset(&mmem_stats, 0, sizeof(mmem_stats));
+  start = clock_time();
+  for(round = 0; round < ROUNDS; round++) {
+    trace(0);
+  }
+
+  printf("mmem-benchmark: %s trace, %d rounds in %lu ms\n", name, ROUNDS,
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+  printf("mmem-benchmark: %lu allocs (%lu failed), %lu frees, %lu bytes moved\n",
+         mmem_stats.allocs, mmem_stats.failed_allocs, mmem_stats.frees,
+         mmem_stats.bytes_moved);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mmem_benchmark_process, "mmem benchmark");
+AUTOSTART_PROCESSES(&mmem_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_benchmark_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("mmem-benchmark: %s allocator, %d operations per mixed round\n",
+         MMEM_SEGREGATED ? "segregated" : "compacting", TRACE_OPS);
+
+  if(!replay(1) || !fragment(1)) {
+    printf("mmem-benchmark: FAIL\n");
+    PROCESS_EXIT();
+  }
+  printf("mmem-benchmark: contents check OK\n");
+
+  measure("mixed", replay);
+  measure("fragmenting", fragment);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
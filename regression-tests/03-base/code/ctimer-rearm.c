@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for callback timers: rearms a large number
+ *         of ctimers, reports the cost, and checks that every pending
+ *         ctimer fires exactly once and no stopped ctimer fires.
+ *         Finally checks that a ctimer can be stopped and its memory
+ *         reused after it has expired but before its callback has
+ *         been called.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TIMERS 1000
+#define REARM_ROUNDS 100
+#define MAX_INTERVAL (CLOCK_SECOND * 4)
+
+static struct ctimer timers[NUM_TIMERS];
+static clock_time_t deadline[NUM_TIMERS];
+static uint8_t fired[NUM_TIMERS];
+static int errors;
+static int pending;
+
+MEMB(reused_memb, struct ctimer, 2);
+static struct ctimer *reused[2];
+static int reused_fired;
+/*---------------------------------------------------------------------------*/
+PROCESS(ctimer_rearm_process, "Ctimer rearm test");
+AUTOSTART_PROCESSES(&ctimer_rearm_process);
+/*---------------------------------------------------------------------------*/
+static void
+callback(void *ptr)
+{
+  int i = (struct ctimer *)ptr - timers;
+
+  if(fired[i] || deadline[i] == 0) {
+    printf("ctimer %d fired unexpectedly\n", i);
+    errors++;
+  } else if(clock_time() - deadline[i] > MAX_INTERVAL) {
+    /* Fired before its deadline. */
+    printf("ctimer %d fired early\n", i);
+    errors++;
+  }
+  fired[i]++;
+  pending--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_timer(int i)
+{
+  clock_time_t interval;
+
+  interval = 1 + random_rand() % MAX_INTERVAL;
+  ctimer_set(&timers[i], interval, callback, &timers[i]);
+  deadline[i] = etimer_expiration_time(&timers[i].etimer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+reuse_callback(void *ptr)
+{
+  struct ctimer *other;
+
+  other = reused[ptr == reused[0]];
+  if(!ctimer_expired(other)) {
+    printf("ctimer reuse: ctimers did not expire together\n");
+    errors++;
+  }
+
+  /* Stop the other ctimer, whose callback has not yet been called,
+     free it and reuse its memory for something else. */
+  ctimer_stop(other);
+  memb_free(&reused_memb, other);
+  memset(memb_alloc(&reused_memb), 0xa5, sizeof(struct ctimer));
+  reused_fired++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_rearm_process, ev, data)
+{
+  static struct etimer et;
+  static int i, round;
+  static clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    set_timer(i);
+  }
+
+  /* Rearm every timer repeatedly, as the MAC and routing layers do for
+     every packet. */
+  start = clock_time();
+  for(round = 0; round < REARM_ROUNDS; round++) {
+    for(i = 0; i < NUM_TIMERS; i++) {
+      set_timer(i);
+    }
+  }
+  printf("ctimer rearm: %d rearms of %d timers took %lu ticks (%lu ticks/s)\n",
+         NUM_TIMERS * REARM_ROUNDS, NUM_TIMERS,
+         (unsigned long)(clock_time() - start), (unsigned long)CLOCK_SECOND);
+
+  /* Stop every other timer; the stopped ones must never fire. */
+  pending = 0;
+  for(i = 0; i < NUM_TIMERS; i++) {
+    if(i & 1) {
+      ctimer_stop(&timers[i]);
+      deadline[i] = 0;
+      if(!ctimer_expired(&timers[i])) {
+        printf("ctimer %d pending after stop\n", i);
+        errors++;
+      }
+    } else {
+      pending++;
+    }
+  }
+
+  etimer_set(&et, MAX_INTERVAL + CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    if(!(i & 1) && fired[i] != 1) {
+      printf("ctimer %d fired %d times\n", i, fired[i]);
+      errors++;
+    }
+  }
+  if(pending != 0) {
+    errors++;
+  }
+
+  /* Set two ctimers in uninitialised memory to expire on the same
+     tick. Whichever callback is called first stops and reuses the
+     other. */
+  for(i = 0; i < 2; i++) {
+    reused[i] = memb_alloc(&reused_memb);
+    memset(reused[i], 0xa5, sizeof(struct ctimer));
+  }
+  start = clock_time();
+  while(clock_time() == start);
+  for(i = 0; i < 2; i++) {
+    ctimer_set(reused[i], 1, reuse_callback, reused[i]);
+  }
+
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  if(reused_fired != 1) {
+    printf("ctimer reuse: %d callbacks called\n", reused_fired);
+    errors++;
+  }
+
+  if(errors == 0) {
+    printf("ctimer rearm: TEST OK\n");
+  } else {
+    printf("ctimer rearm: TEST FAILED (%d errors)\n", errors);
+  }
+
+#ifdef CONTIKI_TARGET_NATIVE
+  exit(errors != 0);
+#endif /* CONTIKI_TARGET_NATIVE */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for the Antelope B+-tree index: runs range
+ *         queries over relations indexed with a B+-tree, both when the
+ *         index is built tuple by tuple and when it is bulk loaded, and
+ *         checks that they return the same tuples as a full scan of an
+ *         unindexed relation.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_ROWS 1000
+#define NUM_VALUES 509
+
+/* The index was created before the tuples were inserted into
+   "indexed", and after they were inserted into "bulk". "plain"
+   has no index, so its queries scan the whole relation. */
+static const char *relations[] = {"plain", "indexed", "bulk"};
+
+static const char *predicates[] = {
+  "v = 17",
+  "v = 1000",
+  "v > 100 AND v < 110",
+  "v >= 100 AND v <= 110",
+  "v > 500",
+  "v < 3",
+  "v > 0",
+  "v >= 200 AND v < 200",
+  "v > 250 AND id > 500",
+};
+
+struct result {
+  unsigned long matching;
+  unsigned long processed;
+  long id_sum;
+};
+
+static db_handle_t handle;
+static int errors;
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_bptree_process, "Antelope B+-tree test");
+AUTOSTART_PROCESSES(&antelope_bptree_process);
+/*---------------------------------------------------------------------------*/
+static void
+query(const char *format, const char *relation)
+{
+  db_result_t result;
+
+  result = db_query(&handle, format, relation);
+  if(DB_ERROR(result)) {
+    printf("\"");
+    printf(format, relation);
+    printf("\" failed: %s\n", db_get_result_message(result));
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_rows(const char *relation)
+{
+  long i;
+
+  for(i = 0; i < NUM_ROWS; i++) {
+    if(DB_ERROR(db_query(&handle, "INSERT (%ld, %ld) INTO %s;",
+                         i, (i * 7919) % NUM_VALUES, relation))) {
+      printf("Inserting into %s failed\n", relation);
+      errors++;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+select_rows(const char *relation, const char *predicate, struct result *r)
+{
+  db_result_t result;
+  attribute_value_t value;
+
+  r->matching = 0;
+  r->processed = 0;
+  r->id_sum = 0;
+
+  result = db_query(&handle, "SELECT id, v FROM %s WHERE %s;",
+                    relation, predicate);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      r->matching++;
+      r->processed++;
+      if(DB_ERROR(db_get_value(&value, &handle, 0))) {
+        result = DB_IMPLEMENTATION_ERROR;
+        break;
+      }
+      r->id_sum += db_value_to_long(&value);
+    } else if(result == DB_OK) {
+      r->processed++;
+    } else {
+      break;
+    }
+  }
+  db_free(&handle);
+
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_bptree_process, ev, data)
+{
+  struct result expected, r;
+  db_result_t result;
+  int i, j;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(i = 0; i < sizeof(relations) / sizeof(relations[0]); i++) {
+    db_query(&handle, "REMOVE INDEX %s.v;", relations[i]);
+    db_query(&handle, "REMOVE RELATION %s;", relations[i]);
+    query("CREATE RELATION %s;", relations[i]);
+    query("CREATE ATTRIBUTE id DOMAIN LONG IN %s;", relations[i]);
+    query("CREATE ATTRIBUTE v DOMAIN INT IN %s;", relations[i]);
+  }
+
+  insert_rows("plain");
+  query("CREATE INDEX %s.v TYPE BPTREE;", "indexed");
+  insert_rows("indexed");
+  insert_rows("bulk");
+  query("CREATE INDEX %s.v TYPE BPTREE;", "bulk");
+
+  for(i = 0; i < sizeof(predicates) / sizeof(predicates[0]); i++) {
+    result = select_rows("plain", predicates[i], &expected);
+    if(DB_ERROR(result)) {
+      printf("Scanning for \"%s\" failed: %s\n", predicates[i],
+             db_get_result_message(result));
+      errors++;
+      continue;
+    }
+    printf("\"%s\": %lu tuples\n", predicates[i], expected.matching);
+
+    for(j = 1; j < sizeof(relations) / sizeof(relations[0]); j++) {
+      result = select_rows(relations[j], predicates[i], &r);
+      if(DB_ERROR(result)) {
+        printf("Query \"%s\" on %s failed: %s\n", predicates[i],
+               relations[j], db_get_result_message(result));
+        errors++;
+      } else if(r.matching != expected.matching ||
+                r.id_sum != expected.id_sum) {
+        printf("Query \"%s\" on %s returned %lu tuples, expected %lu\n",
+               predicates[i], relations[j], r.matching, expected.matching);
+        errors++;
+      } else if(expected.matching < NUM_ROWS / 10 &&
+                r.processed >= NUM_ROWS) {
+        printf("Query \"%s\" on %s did not use the index\n",
+               predicates[i], relations[j]);
+        errors++;
+      }
+    }
+  }
+
+  for(i = 0; i < sizeof(relations) / sizeof(relations[0]); i++) {
+    db_query(&handle, "REMOVE INDEX %s.v;", relations[i]);
+    db_query(&handle, "REMOVE RELATION %s;", relations[i]);
+  }
+
+  if(errors == 0) {
+    printf("antelope bptree: TEST OK\n");
+  } else {
+    printf("antelope bptree: TEST FAILED (%d errors)\n", errors);
+  }
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for Antelope joins: joins pairs of relations
+ *         whose sizes and indexes make relation_join() choose each of
+ *         its join methods, and checks the results against a nested
+ *         loop over the inserted keys.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct join_test {
+  const char *description;
+  const char *left;
+  const char *right;
+  /* The index types to create on the join attributes, if any. */
+  const char *left_index;
+  const char *right_index;
+  int left_rows;
+  int right_rows;
+  /* Multipliers and modulus for the keys, which must be ascending for
+     inline indexes. Key = (row * mul) / div % mod. */
+  int left_mul, left_div;
+  int right_mul, right_div;
+  int mod;
+};
+
+static const struct join_test tests[] = {
+  {"hash join", "lhash", "rhash", NULL, NULL,
+   DB_JOIN_HASH_SIZE / 2, 200, 7, 1, 11, 1, 53},
+  {"partitioned hash join", "lpart", "rpart", NULL, NULL,
+   DB_JOIN_HASH_SIZE * 4, DB_JOIN_HASH_SIZE * 5, 7, 1, 11, 1, 97},
+  {"index join", "lindex", "rindex", NULL, "BPTREE",
+   10, 300, 13, 1, 17, 1, 101},
+  {"merge join", "lmerge", "rmerge", "INLINE", "INLINE",
+   120, 150, 1, 2, 1, 3, 1000},
+};
+
+static db_handle_t handle;
+static int errors;
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_join_process, "Antelope join test");
+AUTOSTART_PROCESSES(&antelope_join_process);
+/*---------------------------------------------------------------------------*/
+static long
+key(int row, int mul, int div, int mod)
+{
+  return (long)row * mul / div % mod;
+}
+/*---------------------------------------------------------------------------*/
+static void
+query(const char *format, const char *relation, const char *arg)
+{
+  db_result_t result;
+
+  result = db_query(&handle, format, relation, arg);
+  if(DB_ERROR(result)) {
+    printf("\"");
+    printf(format, relation, arg);
+    printf("\" failed: %s\n", db_get_result_message(result));
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+create(const char *relation, const char *id, const char *index_type,
+       int rows, int mul, int div, int mod)
+{
+  int i;
+
+  db_query(&handle, "REMOVE INDEX %s.k;", relation);
+  db_query(&handle, "REMOVE RELATION %s;", relation);
+  query("CREATE RELATION %s;", relation, NULL);
+  query("CREATE ATTRIBUTE %s DOMAIN LONG IN %s;", id, relation);
+  query("CREATE ATTRIBUTE k DOMAIN INT IN %s;", relation, NULL);
+  if(index_type != NULL) {
+    query("CREATE INDEX %s.k TYPE %s;", relation, index_type);
+  }
+
+  for(i = 0; i < rows; i++) {
+    if(DB_ERROR(db_query(&handle, "INSERT (%d, %ld) INTO %s;",
+                         i, key(i, mul, div, mod), relation))) {
+      printf("Inserting into %s failed\n", relation);
+      errors++;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_test(const struct join_test *t)
+{
+  db_result_t result;
+  attribute_value_t left_id, right_id;
+  unsigned long expected_count, count;
+  long expected_sum, sum;
+  long left_key;
+  int i, j;
+
+  create(t->left, "a", t->left_index, t->left_rows,
+         t->left_mul, t->left_div, t->mod);
+  create(t->right, "b", t->right_index, t->right_rows,
+         t->right_mul, t->right_div, t->mod);
+
+  expected_count = 0;
+  expected_sum = 0;
+  for(i = 0; i < t->left_rows; i++) {
+    left_key = key(i, t->left_mul, t->left_div, t->mod);
+    for(j = 0; j < t->right_rows; j++) {
+      if(key(j, t->right_mul, t->right_div, t->mod) == left_key) {
+        expected_count++;
+        expected_sum += (long)i * t->right_rows + j;
+      }
+    }
+  }
+
+  count = 0;
+  sum = 0;
+  result = db_query(&handle, "JOIN %s, %s ON k PROJECT a, b;",
+                    t->left, t->right);
+  while(!DB_ERROR(result) && db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&left_id, &handle, 0)) ||
+         DB_ERROR(db_get_value(&right_id, &handle, 1))) {
+        result = DB_IMPLEMENTATION_ERROR;
+        break;
+      }
+      count++;
+      sum += db_value_to_long(&left_id) * t->right_rows +
+             db_value_to_long(&right_id);
+    } else if(result == DB_FINISHED) {
+      break;
+    }
+  }
+  db_free(&handle);
+
+  if(DB_ERROR(result)) {
+    printf("%s: the join failed: %s\n", t->description,
+           db_get_result_message(result));
+    errors++;
+  } else if(count != expected_count || sum != expected_sum) {
+    printf("%s: %lu tuples joined, expected %lu\n", t->description,
+           count, expected_count);
+    errors++;
+  } else {
+    printf("%s: %lu tuples joined\n", t->description, count);
+  }
+
+  db_query(&handle, "REMOVE INDEX %s.k;", t->left);
+  db_query(&handle, "REMOVE RELATION %s;", t->left);
+  db_query(&handle, "REMOVE INDEX %s.k;", t->right);
+  db_query(&handle, "REMOVE RELATION %s;", t->right);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_join_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    run_test(&tests[i]);
+  }
+
+  if(errors == 0) {
+    printf("antelope join: TEST OK\n");
+  } else {
+    printf("antelope join: TEST FAILED (%d errors)\n", errors);
+  }
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
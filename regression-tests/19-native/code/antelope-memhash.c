@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for the Antelope memhash index. Two hash
+ *         indexes are first driven directly through the index API,
+ *         and every lookup is checked against a scan of a table that
+ *         records what was inserted and deleted. Then queries over
+ *         relations indexed with memhash are checked against a full
+ *         scan of an unindexed relation, before and after one of the
+ *         indexes runs out of entries.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Both indexes are filled to well above the initial number of
+   buckets, so that they split several rounds. The indexes share the
+   entry pool, and more entries than buckets means that some distinct
+   keys share a bucket. */
+#define RAW_ROWS_A 120
+#define RAW_VALUES_A 97
+#define RAW_ROWS_B 100
+
+#define MAX_TUPLES (2 * DB_MEMHASH_ENTRY_LIMIT)
+
+#define NUM_ROWS 100
+#define NUM_VALUES 37
+
+struct model_entry {
+  long key;
+  uint8_t live;
+};
+
+struct model {
+  index_t index;
+  struct model_entry entries[MAX_TUPLES];
+  tuple_id_t count;
+};
+
+static struct model raw[2];
+static uint8_t seen[MAX_TUPLES];
+
+/* "plain" has no index, so its queries scan the whole relation. */
+static const char *relations[] = {"plain", "hashed", "hashed2"};
+
+static const struct {
+  const char *predicate;
+  int indexed;
+} predicates[] = {
+  {"v = 17", 1},
+  {"v = 1000", 1},
+  {"v = 0", 1},
+  {"v >= 10 AND v <= 11", 1},
+  {"v > 30", 0},
+  {"v > 0", 0},
+  {"v = 5 AND id > 50", 1},
+};
+
+struct result {
+  unsigned long matching;
+  unsigned long processed;
+  long id_sum;
+};
+
+static db_handle_t handle;
+static int errors;
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_memhash_process, "Antelope memhash test");
+AUTOSTART_PROCESSES(&antelope_memhash_process);
+/*---------------------------------------------------------------------------*/
+static void
+raw_insert(struct model *m, long key)
+{
+  attribute_value_t value;
+
+  value.domain = DOMAIN_LONG;
+  VALUE_LONG(&value) = key;
+  if(DB_ERROR(index_memhash.insert(&m->index, &value, m->count))) {
+    printf("Inserting %ld failed\n", key);
+    errors++;
+  }
+  m->entries[m->count].key = key;
+  m->entries[m->count].live = 1;
+  m->count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+raw_delete(struct model *m, long key)
+{
+  attribute_value_t value;
+  tuple_id_t i;
+
+  value.domain = DOMAIN_LONG;
+  VALUE_LONG(&value) = key;
+  if(DB_ERROR(index_memhash.delete(&m->index, &value))) {
+    printf("Deleting %ld failed\n", key);
+    errors++;
+  }
+  for(i = 0; i < m->count; i++) {
+    if(m->entries[i].key == key) {
+      m->entries[i].live = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static tuple_id_t
+raw_live(struct model *m)
+{
+  tuple_id_t i;
+  tuple_id_t live;
+
+  for(i = live = 0; i < m->count; i++) {
+    live += m->entries[i].live;
+  }
+  return live;
+}
+/*---------------------------------------------------------------------------*/
+/* Looks up the keys in [min, max] and checks that each live tuple
+   with such a key is returned exactly once. */
+static void
+raw_lookup(struct model *m, long min, long max)
+{
+  index_iterator_t iterator;
+  tuple_id_t tuple_id;
+  tuple_id_t expected;
+  tuple_id_t found;
+  tuple_id_t i;
+
+  memset(&iterator, 0, sizeof(iterator));
+  iterator.index = &m->index;
+  iterator.min_value.domain = DOMAIN_LONG;
+  VALUE_LONG(&iterator.min_value) = min;
+  iterator.max_value.domain = DOMAIN_LONG;
+  VALUE_LONG(&iterator.max_value) = max;
+  memset(seen, 0, sizeof(seen));
+
+  for(found = 0;
+      (tuple_id = index_memhash.get_next(&iterator)) != INVALID_TUPLE;
+      found++) {
+    if(tuple_id >= m->count || !m->entries[tuple_id].live ||
+       m->entries[tuple_id].key < min || m->entries[tuple_id].key > max ||
+       seen[tuple_id]) {
+      printf("Lookup of [%ld, %ld] returned tuple %lu\n",
+             min, max, (unsigned long)tuple_id);
+      errors++;
+      return;
+    }
+    seen[tuple_id] = 1;
+  }
+
+  for(i = expected = 0; i < m->count; i++) {
+    if(m->entries[i].live &&
+       m->entries[i].key >= min && m->entries[i].key <= max) {
+      expected++;
+    }
+  }
+
+  if(found != expected) {
+    printf("Lookup of [%ld, %ld] returned %lu tuples, expected %lu\n",
+           min, max, (unsigned long)found, (unsigned long)expected);
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+raw_check(struct model *m, long min, long max)
+{
+  tuple_id_t i;
+
+  if(m->index.flags != INDEX_READY) {
+    printf("The index has failed\n");
+    errors++;
+    return;
+  }
+
+  /* Every key that was ever inserted, whether it is deleted or not. */
+  for(i = 0; i < m->count; i++) {
+    raw_lookup(m, m->entries[i].key, m->entries[i].key);
+  }
+  raw_lookup(m, min - 1, min - 1);
+  raw_lookup(m, max + 1, max + 1);
+  raw_lookup(m, min, max);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_index_api(void)
+{
+  struct model *a;
+  struct model *b;
+  long key;
+  tuple_id_t used;
+  tuple_id_t i;
+
+  a = &raw[0];
+  b = &raw[1];
+
+  memset(raw, 0, sizeof(raw));
+  a->index.api = b->index.api = &index_memhash;
+  if(DB_ERROR(index_memhash.create(&a->index)) ||
+     DB_ERROR(index_memhash.create(&b->index))) {
+    printf("Creating the hash indexes failed\n");
+    errors++;
+    return;
+  }
+
+  /* "a" has many duplicates of each key. The keys of "b" are
+     negative as well as positive, and half of them differ from the
+     others only above the low 16 bits. */
+  for(i = 0; i < RAW_ROWS_A; i++) {
+    raw_insert(a, ((long)i * 7919) % RAW_VALUES_A);
+    if(i < RAW_ROWS_B) {
+      key = ((long)i * 104729) % 1000 - 500;
+      raw_insert(b, i & 1 ? key + 0x10000 : key);
+    }
+  }
+  raw_check(a, 0, RAW_VALUES_A - 1);
+  raw_check(b, -500, 0x10000 + 500);
+
+  /* Delete all entries of every third key, and a key that is not
+     there. */
+  for(key = 0; key < RAW_VALUES_A; key += 3) {
+    raw_delete(a, key);
+  }
+  for(i = 0; i < RAW_ROWS_B; i += 5) {
+    raw_delete(b, b->entries[i].key);
+  }
+  raw_delete(a, RAW_VALUES_A);
+  raw_check(a, 0, RAW_VALUES_A - 1);
+  raw_check(b, -500, 0x10000 + 500);
+
+  /* Deleted keys can be inserted again. */
+  for(key = 0; key < RAW_VALUES_A / 3; key += 3) {
+    raw_insert(a, key);
+  }
+  raw_check(a, 0, RAW_VALUES_A - 1);
+
+  /* Exhaust the shared entries through "b". The index gives up and
+     frees its entries, which "a" can then use up. */
+  used = raw_live(a) + raw_live(b);
+  for(i = 0; i < DB_MEMHASH_ENTRY_LIMIT && b->count < MAX_TUPLES; i++) {
+    raw_insert(b, 1000 + i);
+    if(b->index.flags & INDEX_LOAD_ERROR) {
+      break;
+    }
+  }
+  if(!(b->index.flags & INDEX_LOAD_ERROR) ||
+     i != DB_MEMHASH_ENTRY_LIMIT - used) {
+    printf("The hash index failed after %lu insertions, expected %lu\n",
+           (unsigned long)i, (unsigned long)(DB_MEMHASH_ENTRY_LIMIT - used));
+    errors++;
+  }
+  raw_check(a, 0, RAW_VALUES_A - 1);
+
+  for(key = RAW_VALUES_A; raw_live(a) < DB_MEMHASH_ENTRY_LIMIT; key++) {
+    raw_insert(a, key);
+  }
+  raw_check(a, 0, key - 1);
+  raw_insert(a, key);
+  if(!(a->index.flags & INDEX_LOAD_ERROR)) {
+    printf("The hash index did not fail when the entries ran out\n");
+    errors++;
+  }
+
+  index_memhash.destroy(&a->index);
+  index_memhash.destroy(&b->index);
+
+  /* All entries are back in the pool. */
+  memset(a, 0, sizeof(*a));
+  a->index.api = &index_memhash;
+  if(DB_ERROR(index_memhash.create(&a->index))) {
+    printf("Creating a hash index again failed\n");
+    errors++;
+    return;
+  }
+  for(i = 0; i < DB_MEMHASH_ENTRY_LIMIT; i++) {
+    raw_insert(a, i);
+  }
+  raw_check(a, 0, DB_MEMHASH_ENTRY_LIMIT - 1);
+  index_memhash.destroy(&a->index);
+}
+/*---------------------------------------------------------------------------*/
+static void
+query(const char *format, const char *relation)
+{
+  db_result_t result;
+
+  result = db_query(&handle, format, relation);
+  if(DB_ERROR(result)) {
+    printf("\"");
+    printf(format, relation);
+    printf("\" failed: %s\n", db_get_result_message(result));
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_rows(const char *relation, long first, long last)
+{
+  long i;
+
+  for(i = first; i < last; i++) {
+    if(DB_ERROR(db_query(&handle, "INSERT (%ld, %ld) INTO %s;",
+                         i, (i * 7919) % NUM_VALUES, relation))) {
+      printf("Inserting into %s failed\n", relation);
+      errors++;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+select_rows(const char *relation, const char *predicate, struct result *r)
+{
+  db_result_t result;
+  attribute_value_t value;
+
+  r->matching = 0;
+  r->processed = 0;
+  r->id_sum = 0;
+
+  result = db_query(&handle, "SELECT id, v FROM %s WHERE %s;",
+                    relation, predicate);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      r->matching++;
+      r->processed++;
+      if(DB_ERROR(db_get_value(&value, &handle, 0))) {
+        result = DB_IMPLEMENTATION_ERROR;
+        break;
+      }
+      r->id_sum += db_value_to_long(&value);
+    } else if(result == DB_OK) {
+      r->processed++;
+    } else {
+      break;
+    }
+  }
+  db_free(&handle);
+
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Compares the queries on a hashed relation with a full scan of
+   "plain". If the index has failed, the queries must scan as well. */
+static void
+compare(const char *relation, unsigned long rows, int index_failed)
+{
+  struct result expected, r;
+  db_result_t result;
+  int i;
+
+  for(i = 0; i < sizeof(predicates) / sizeof(predicates[0]); i++) {
+    result = select_rows("plain", predicates[i].predicate, &expected);
+    if(DB_ERROR(result)) {
+      printf("Scanning for \"%s\" failed: %s\n", predicates[i].predicate,
+             db_get_result_message(result));
+      errors++;
+      continue;
+    }
+
+    result = select_rows(relation, predicates[i].predicate, &r);
+    if(DB_ERROR(result)) {
+      printf("Query \"%s\" on %s failed: %s\n", predicates[i].predicate,
+             relation, db_get_result_message(result));
+      errors++;
+    } else if(r.matching != expected.matching ||
+              r.id_sum != expected.id_sum) {
+      printf("Query \"%s\" on %s returned %lu tuples, expected %lu\n",
+             predicates[i].predicate, relation, r.matching,
+             expected.matching);
+      errors++;
+    } else if(predicates[i].indexed && !index_failed &&
+              r.processed >= rows) {
+      printf("Query \"%s\" on %s did not use the index\n",
+             predicates[i].predicate, relation);
+      errors++;
+    } else if(index_failed && r.processed != rows) {
+      printf("Query \"%s\" on %s used a failed index\n",
+             predicates[i].predicate, relation);
+      errors++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_memhash_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  test_index_api();
+
+  db_init();
+
+  for(i = 0; i < sizeof(relations) / sizeof(relations[0]); i++) {
+    db_query(&handle, "REMOVE INDEX %s.v;", relations[i]);
+    db_query(&handle, "REMOVE RELATION %s;", relations[i]);
+    query("CREATE RELATION %s;", relations[i]);
+    query("CREATE ATTRIBUTE id DOMAIN LONG IN %s;", relations[i]);
+    query("CREATE ATTRIBUTE v DOMAIN INT IN %s;", relations[i]);
+  }
+
+  query("CREATE INDEX %s.v TYPE MEMHASH;", "hashed");
+  query("CREATE INDEX %s.v TYPE MEMHASH;", "hashed2");
+  for(i = 0; i < sizeof(relations) / sizeof(relations[0]); i++) {
+    insert_rows(relations[i], 0, NUM_ROWS);
+  }
+  compare("hashed", NUM_ROWS, 0);
+  compare("hashed2", NUM_ROWS, 0);
+
+  /* The two indexes together need more entries than there are, so
+     the index of "hashed2" gives up on the way. */
+  insert_rows("plain", NUM_ROWS, 2 * NUM_ROWS);
+  insert_rows("hashed2", NUM_ROWS, 2 * NUM_ROWS);
+  compare("hashed2", 2 * NUM_ROWS, 1);
+
+  for(i = 0; i < sizeof(relations) / sizeof(relations[0]); i++) {
+    db_query(&handle, "REMOVE INDEX %s.v;", relations[i]);
+    db_query(&handle, "REMOVE RELATION %s;", relations[i]);
+  }
+
+  if(errors == 0) {
+    printf("antelope memhash: TEST OK\n");
+  } else {
+    printf("antelope memhash: TEST FAILED (%d errors)\n", errors);
+  }
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for the hashed IPv6 neighbor cache: fills the
+ *         cache past its capacity, replaces and removes neighbors, and
+ *         checks after each step that uip_ds6_nbr_lookup() agrees with
+ *         a scan of the neighbor table.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !UIP_DS6_NBR_HASH
+#error This test requires UIP_DS6_NBR_CONF_HASH
+#endif
+
+/* Enough addresses to evict half of the neighbor cache. */
+#define NUM_ADDRS (NBR_TABLE_MAX_NEIGHBORS + NBR_TABLE_MAX_NEIGHBORS / 2)
+
+static int errors;
+/*---------------------------------------------------------------------------*/
+PROCESS(ds6_nbr_hash_process, "IPv6 neighbor hash test");
+AUTOSTART_PROCESSES(&ds6_nbr_hash_process);
+/*---------------------------------------------------------------------------*/
+static void
+set_ipaddr(uip_ipaddr_t *ipaddr, int i, int generation)
+{
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7400 + generation, 0, i + 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_lladdr(uip_lladdr_t *lladdr, int i)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->addr[0] = 0x02;
+  lladdr->addr[sizeof(lladdr->addr) - 1] = i + 1;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+scan(const uip_ipaddr_t *ipaddr)
+{
+  uip_ds6_nbr_t *nbr;
+
+  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
+      nbr = nbr_table_next(ds6_neighbors, nbr)) {
+    if(uip_ipaddr_cmp(&nbr->ipaddr, ipaddr)) {
+      return nbr;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Check the lookup of every test address against a table scan, and
+   return the number of addresses found. */
+static int
+check(const char *step, int generation)
+{
+  uip_ipaddr_t ipaddr;
+  uip_ds6_nbr_t *nbr;
+  int i, g, found;
+
+  found = 0;
+  for(g = 0; g <= generation; g++) {
+    for(i = 0; i < NUM_ADDRS; i++) {
+      set_ipaddr(&ipaddr, i, g);
+      nbr = uip_ds6_nbr_lookup(&ipaddr);
+      if(nbr != scan(&ipaddr)) {
+        printf("%s: lookup of address %d.%d disagrees with the table\n",
+               step, g, i);
+        errors++;
+      }
+      if(nbr != NULL) {
+        found++;
+      }
+    }
+  }
+  if(found != uip_ds6_nbr_num()) {
+    printf("%s: %d addresses found, %d neighbors in the table\n",
+           step, found, uip_ds6_nbr_num());
+    errors++;
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_nbr_hash_process, ev, data)
+{
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  uip_ds6_nbr_t *nbr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Fill the cache, and then add more neighbors, which evicts some of
+     the first ones. */
+  for(i = 0; i < NUM_ADDRS; i++) {
+    set_ipaddr(&ipaddr, i, 0);
+    set_lladdr(&lladdr, i);
+    if(uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE) == NULL) {
+      printf("could not add neighbor %d\n", i);
+      errors++;
+    }
+    if(uip_ds6_nbr_lookup(&ipaddr) == NULL) {
+      printf("neighbor %d not found after adding it\n", i);
+      errors++;
+    }
+  }
+  if(check("add", 0) != NBR_TABLE_MAX_NEIGHBORS) {
+    printf("add: the cache is not full\n");
+    errors++;
+  }
+
+  /* Give every neighbor that is still cached a new IPv6 address. Its
+     old address must no longer be found. */
+  for(i = 0; i < NUM_ADDRS; i++) {
+    set_ipaddr(&ipaddr, i, 0);
+    if(uip_ds6_nbr_lookup(&ipaddr) != NULL) {
+      set_ipaddr(&ipaddr, i, 1);
+      set_lladdr(&lladdr, i);
+      uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE);
+    }
+  }
+  if(check("replace", 1) != NBR_TABLE_MAX_NEIGHBORS) {
+    printf("replace: the number of neighbors changed\n");
+    errors++;
+  }
+  for(i = 0; i < NUM_ADDRS; i++) {
+    set_ipaddr(&ipaddr, i, 0);
+    if(uip_ds6_nbr_lookup(&ipaddr) != NULL) {
+      printf("replace: old address of neighbor %d still found\n", i);
+      errors++;
+    }
+  }
+
+  /* Remove every neighbor. */
+  for(i = 0; i < NUM_ADDRS; i++) {
+    set_ipaddr(&ipaddr, i, 1);
+    nbr = uip_ds6_nbr_lookup(&ipaddr);
+    if(nbr != NULL) {
+      uip_ds6_nbr_rm(nbr);
+    }
+  }
+  if(check("remove", 1) != 0) {
+    printf("remove: neighbors left in the cache\n");
+    errors++;
+  }
+
+  if(errors == 0) {
+    printf("ds6 nbr hash: TEST OK\n");
+  } else {
+    printf("ds6 nbr hash: TEST FAILED (%d errors)\n", errors);
+  }
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
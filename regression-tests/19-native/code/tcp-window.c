@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Regression test for the uIP TCP retransmission queue: plays
+ *         the remote host of a connection by feeding hand-made
+ *         segments to uip_process(), and checks the segments that uIP
+ *         sends in reply.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#if UIP_CONF_IPV6
+#include "net/ipv6/uip-ds6.h"
+#endif /* UIP_CONF_IPV6 */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !UIP_TCP_WINDOW || UIP_TCP_WINDOW_SEGMENTS != 4
+#error This test needs UIP_CONF_TCP_WINDOW_SEGMENTS set to 4
+#endif
+
+#define BUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+
+#define PORT 8080
+#define PEER_PORT 4711
+#define PEER_WINDOW 1024
+#define CHUNK 40
+
+static uip_ipaddr_t host, peer;
+static uint32_t iss, peer_seq;
+static struct uip_conn *conn;
+static int errors;
+
+/* The number of chunks that uIP has told the application were
+   acknowledged, and the number of chunks that the application has to
+   send before it closes the connection, if app_close is set. */
+static uint16_t app_acked;
+static uint16_t app_chunks;
+static uint8_t app_close;
+
+PROCESS(tcp_window_process, "TCP window test");
+PROCESS(tcp_window_app_process, "TCP window test application");
+AUTOSTART_PROCESSES(&tcp_window_process);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t value)
+{
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+/*---------------------------------------------------------------------------*/
+/* The application sends chunk after chunk, byte i of the stream
+   being i & 0xff. It resends the current chunk whenever it is called
+   without uip_acked(), which uIP ignores unless it asked for a
+   retransmission. */
+PROCESS_THREAD(tcp_window_app_process, ev, data)
+{
+  static uint8_t chunk[CHUNK];
+  int i;
+
+  PROCESS_BEGIN();
+
+  tcp_listen(UIP_HTONS(PORT));
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(uip_acked()) {
+      app_acked++;
+    }
+    if(uip_connected() || uip_acked() || uip_rexmit() || uip_poll()) {
+      if(app_acked < app_chunks) {
+        for(i = 0; i < CHUNK; i++) {
+          chunk[i] = app_acked * CHUNK + i;
+        }
+        uip_send(chunk, CHUNK);
+      } else if(app_close) {
+        uip_close();
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/* Send a segment without data from the remote host. A SYN carries
+   an MSS option, as uIP does not set the MSS of a connection
+   otherwise. */
+static void
+peer_send(uint8_t flags, uint32_t ackoffset)
+{
+  int optlen;
+
+  optlen = (flags & TCP_SYN) ? 4 : 0;
+
+#if UIP_CONF_IPV6
+  BUF->vtc = 0x60;
+  BUF->tcflow = 0;
+  BUF->flow = 0;
+  BUF->len[0] = 0;
+  BUF->len[1] = UIP_TCPH_LEN + optlen;
+  uip_ext_len = 0;
+#else /* UIP_CONF_IPV6 */
+  BUF->vhl = 0x45;
+  BUF->tos = 0;
+  BUF->len[0] = 0;
+  BUF->len[1] = UIP_IPTCPH_LEN + optlen;
+  BUF->ipid[0] = BUF->ipid[1] = 0;
+  BUF->ipoffset[0] = BUF->ipoffset[1] = 0;
+#endif /* UIP_CONF_IPV6 */
+  BUF->proto = UIP_PROTO_TCP;
+  BUF->ttl = 64;
+  uip_ipaddr_copy(&BUF->srcipaddr, &peer);
+  uip_ipaddr_copy(&BUF->destipaddr, &host);
+#if !UIP_CONF_IPV6
+  BUF->ipchksum = 0;
+  BUF->ipchksum = ~(uip_ipchksum());
+#endif /* !UIP_CONF_IPV6 */
+
+  BUF->srcport = UIP_HTONS(PEER_PORT);
+  BUF->destport = UIP_HTONS(PORT);
+  put32(BUF->seqno, peer_seq);
+  put32(BUF->ackno, (flags & TCP_ACK) ? iss + 1 + ackoffset : 0);
+  BUF->tcpoffset = ((UIP_TCPH_LEN + optlen) / 4) << 4;
+  BUF->flags = flags;
+  BUF->wnd[0] = PEER_WINDOW >> 8;
+  BUF->wnd[1] = PEER_WINDOW & 0xff;
+  BUF->urgp[0] = BUF->urgp[1] = 0;
+  if(optlen > 0) {
+    /* An MSS option. */
+    BUF->optdata[0] = 2;
+    BUF->optdata[1] = 4;
+    BUF->optdata[2] = UIP_TCP_MSS >> 8;
+    BUF->optdata[3] = UIP_TCP_MSS & 0xff;
+  }
+  uip_len = UIP_IPTCPH_LEN + optlen;
+  BUF->tcpchksum = 0;
+  BUF->tcpchksum = ~(uip_tcpchksum());
+
+  uip_input();
+}
+/*---------------------------------------------------------------------------*/
+/* Check that uIP sent nothing in reply. */
+static void
+expect_nothing(const char *step)
+{
+  if(uip_len > 0) {
+    printf("%s: unexpected segment, flags 0x%02x, sequence number +%lu\n",
+           step, BUF->flags, (unsigned long)(get32(BUF->seqno) - iss - 1));
+    errors++;
+  }
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Check that uIP sent a segment with the given flags, and len bytes
+   of data that start offset bytes into the stream. */
+static void
+expect_segment(const char *step, uint8_t flags, uint32_t offset, int len)
+{
+  int i, datalen;
+  uint32_t seq;
+  const uint8_t *data;
+
+  if(uip_len == 0) {
+    printf("%s: no segment sent\n", step);
+    errors++;
+    return;
+  }
+  datalen = uip_len - UIP_IPTCPH_LEN;
+  seq = get32(BUF->seqno) - iss - 1;
+  if(BUF->proto != UIP_PROTO_TCP || (BUF->flags & flags) != flags ||
+     (BUF->flags & (TCP_SYN | TCP_FIN)) != (flags & (TCP_SYN | TCP_FIN)) ||
+     seq != offset || datalen != len) {
+    printf("%s: got flags 0x%02x, sequence number +%lu, %d bytes; "
+           "expected flags 0x%02x, +%lu, %d bytes\n", step,
+           BUF->flags, (unsigned long)seq, datalen,
+           flags, (unsigned long)offset, len);
+    errors++;
+  } else {
+    data = &uip_buf[UIP_LLH_LEN + UIP_IPTCPH_LEN];
+    for(i = 0; i < len; i++) {
+      if(data[i] != (uint8_t)(offset + i)) {
+        printf("%s: wrong data at byte %lu\n", step,
+               (unsigned long)(offset + i));
+        errors++;
+        break;
+      }
+    }
+  }
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+poll_conn(void)
+{
+  uip_poll_conn(conn);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_window_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+#if UIP_CONF_IPV6
+  uip_ipaddr_copy(&host, &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_ip6addr(&peer, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+#else /* UIP_CONF_IPV6 */
+  uip_ipaddr(&host, 10, 0, 0, 1);
+  uip_sethostaddr(&host);
+  uip_ipaddr(&peer, 10, 0, 0, 2);
+#endif /* UIP_CONF_IPV6 */
+
+  app_chunks = 6;
+  process_start(&tcp_window_app_process, NULL);
+
+  /* The whole test runs without yielding, so that tcpip_process does
+     not send segments of its own. */
+
+  /* Open the connection. */
+  peer_seq = 1000;
+  peer_send(TCP_SYN, 0);
+  if(uip_len == 0 || BUF->flags != (TCP_SYN | TCP_ACK)) {
+    printf("handshake: no SYN-ACK\n");
+    printf("tcp window: TEST FAILED\n");
+    exit(1);
+  }
+  iss = get32(BUF->seqno);
+  uip_len = 0;
+  peer_seq++;
+  peer_send(TCP_ACK, 0);
+  expect_segment("connect", TCP_ACK, 0, CHUNK);
+  conn = uip_conn;
+
+  /* The application is told that its data was acknowledged as soon
+     as it was queued, so it fills the window without waiting for the
+     remote host. */
+  for(i = 1; i < UIP_TCP_WINDOW_SEGMENTS; i++) {
+    poll_conn();
+    expect_segment("fill window", TCP_ACK, i * CHUNK, CHUNK);
+  }
+  poll_conn();
+  expect_nothing("full window");
+  if(app_acked != UIP_TCP_WINDOW_SEGMENTS - 1) {
+    printf("full window: application told of %d acknowledged chunks\n",
+           app_acked);
+    errors++;
+  }
+
+  /* A cumulative ACK of two segments opens the window for one more
+     segment. */
+  peer_send(TCP_ACK, 2 * CHUNK);
+  expect_segment("cumulative ACK", TCP_ACK, 4 * CHUNK, CHUNK);
+
+  /* An ACK of half a segment. */
+  peer_send(TCP_ACK, 2 * CHUNK + CHUNK / 2);
+  expect_segment("partial ACK", TCP_ACK, 5 * CHUNK, CHUNK);
+
+  /* The third duplicate ACK makes uIP resend the rest of the
+     partially acknowledged segment. */
+  peer_send(TCP_ACK, 2 * CHUNK + CHUNK / 2);
+  expect_nothing("first duplicate ACK");
+  peer_send(TCP_ACK, 2 * CHUNK + CHUNK / 2);
+  expect_nothing("second duplicate ACK");
+  peer_send(TCP_ACK, 2 * CHUNK + CHUNK / 2);
+  expect_segment("fast retransmit", TCP_ACK, 2 * CHUNK + CHUNK / 2,
+                 CHUNK / 2);
+
+  /* An ACK of the resent data during recovery makes uIP resend the
+     next segment, rather than send new data. */
+  peer_send(TCP_ACK, 3 * CHUNK);
+  expect_segment("recovery", TCP_ACK, 3 * CHUNK, CHUNK);
+
+  /* Once everything has been acknowledged, the application sends its
+     last chunk and then closes the connection. The FIN waits for the
+     chunk to be acknowledged. */
+  app_chunks = 7;
+  app_close = 1;
+  peer_send(TCP_ACK, 6 * CHUNK);
+  expect_segment("end of recovery", TCP_ACK, 6 * CHUNK, CHUNK);
+  poll_conn();
+  expect_nothing("close with data queued");
+
+  /* Without an ACK, the queued chunk is resent when the
+     retransmission timer expires. */
+  for(i = 0; i < 2 * UIP_RTO + 2 && uip_len == 0; i++) {
+    uip_periodic_conn(conn);
+  }
+  expect_segment("timeout", TCP_ACK, 6 * CHUNK, CHUNK);
+
+  peer_send(TCP_ACK, 7 * CHUNK);
+  expect_segment("final ACK", TCP_FIN | TCP_ACK, 7 * CHUNK, 0);
+
+  if(errors == 0) {
+    printf("tcp window: TEST OK\n");
+  } else {
+    printf("tcp window: TEST FAILED (%d errors)\n", errors);
+  }
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/